@@ -0,0 +1,211 @@
+// Benchmarks for the episode throughput and the learner's hot path.
+//
+// Usage: ./bench.exe [filter]
+// Only benchmarks whose name contains the filter are run.
+//
+// Each benchmark times batches of calls with a fixed seed. After a few
+// warmup batches, the time per call is reported as percentiles over the
+// repetitions, which are stable from run to run unlike a single wall-clock
+// measurement.
+//
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "agent.hpp"
+#include "environment.hpp"
+#include "episode.hpp"
+#include "montecarlo.hpp"
+#include "policy.hpp"
+#include "seed.hpp"
+#include "td.hpp"
+
+using namespace std;
+
+// Seed used by every benchmark.
+const unsigned BENCH_SEED = 12345;
+// Number of untimed batches before measuring.
+const int WARMUP_REPS = 3;
+// Number of timed batches.
+const int TIMED_REPS = 15;
+
+// Keeps the compiler from optimizing away a benchmarked result.
+template <class T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Only benchmarks matching the filter are run.
+static const char* filter = "";
+// Results are reported on stdout even while cout is silenced.
+static ostream report(cout.rdbuf());
+
+// Times the given function, which performs ops operations per call.
+//
+// Prints the median, 10th and 90th percentile time per operation
+// and the operations per second at the median.
+//
+template <class Function>
+void bench(const string& name, unsigned long long ops, Function fn) {
+    if (name.find(filter) == string::npos) return;
+    generator.seed(BENCH_SEED);
+    for (int r=0; r<WARMUP_REPS; r++)
+        fn();
+    vector<double> ns_per_op;
+    for (int r=0; r<TIMED_REPS; r++) {
+        auto start = chrono::steady_clock::now();
+        fn();
+        auto stop = chrono::steady_clock::now();
+        ns_per_op.push_back(chrono::duration<double, nano>(stop - start).count() / ops);
+    }
+    sort(ns_per_op.begin(), ns_per_op.end());
+    double p10 = ns_per_op[TIMED_REPS/10];
+    double p50 = ns_per_op[TIMED_REPS/2];
+    double p90 = ns_per_op[TIMED_REPS - 1 - TIMED_REPS/10];
+    report << left << setw(40) << name << right << fixed << setprecision(1)
+         << setw(10) << p50 << " ns/op"
+         << "  [p10 " << setw(8) << p10 << ", p90 " << setw(8) << p90 << "]"
+         << setw(14) << setprecision(0) << 1e9/p50 << " ops/s" << endl;
+}
+
+// Silences policy debug output while benchmarking.
+//
+struct SilenceCout {
+    ostringstream sink;
+    streambuf* saved;
+    SilenceCout() : saved(cout.rdbuf(sink.rdbuf())) {}
+    ~SilenceCout() { cout.rdbuf(saved); }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) filter = argv[1];
+    const unsigned long long N = 1000000;
+
+    report << left << setw(40) << "benchmark" << right 
+         << setw(16) << "median" << "  [percentiles]" << endl;
+
+    //
+    // Environment
+    //
+    useDealer(SequentialDealer);
+    bench("dealCard/infinite", N, [&]() {
+        for (unsigned long long i=0; i<N; i++) doNotOptimize(dealCard());
+    });
+    useShoe(6, 0.75);
+    bench("dealCard/shoe6", N, [&]() {
+        for (unsigned long long i=0; i<N; i++) doNotOptimize(dealCard());
+    });
+    useShoe(0, 1);
+    const char* dealer_names[] = {"sequential", "batched", "alias", "expected"};
+    for (int mode=SequentialDealer; mode<=ExpectedDealer; mode++) {
+        useDealer((DealerMode) mode);
+        bench(string("endGame/") + dealer_names[mode], N, [&]() {
+            for (unsigned long long i=0; i<N; i++)
+                doNotOptimize(finalReward(18, 2 + i%10));
+        });
+    }
+    useDealer(BatchedDealer);
+    const char* start_names[] = {"fixed", "dealt", "exploring", "stratified"};
+    for (int mode=FixedStart; mode<=StratifiedStart; mode++) {
+        useStarts((StartMode) mode);
+        bench(string("setStartingState/") + start_names[mode], N, [&]() {
+            State state;
+            for (unsigned long long i=0; i<N; i++) {
+                setStartingState(&state);
+                doNotOptimize(state);
+            }
+        });
+    }
+    useStarts(DealtStart);
+
+    //
+    // Value lookups
+    //
+    GreedyPolicy greedy;
+    Agent dense_agent(greedy);
+    Agent map_agent(new MapValueTable, greedy);
+    State states[64];
+    for (int i=0; i<64; i++)
+        states[i] = State(4 + i%17, 2 + i%10, i%3 == 0);
+    bench("getStateActionValue/dense", N, [&]() {
+        for (unsigned long long i=0; i<N; i++)
+            doNotOptimize(dense_agent.getStateActionValue(&states[i%64], (Action) (i&1)));
+    });
+    bench("getStateActionValue/map", N, [&]() {
+        for (unsigned long long i=0; i<N; i++)
+            doNotOptimize(map_agent.getStateActionValue(&states[i%64], (Action) (i&1)));
+    });
+
+    //
+    // Action selection
+    //
+    RandomPolicy random;
+    EpsilonGreedyPolicy egreedy(0.1);
+    UpperConfidenceBoundPolicy ucb(0.5);
+    ActionValues values = dense_agent.getActionValues(&states[0]);
+    auto bench_select = [&](const string& name, auto& policy) {
+        Policy& virtual_policy = policy;
+        bench("select/virtual/" + name, N, [&]() {
+            for (unsigned long long i=0; i<N; i++) doNotOptimize(virtual_policy.select(values));
+        });
+        bench("select/static/" + name, N, [&]() {
+            for (unsigned long long i=0; i<N; i++) doNotOptimize(selectAction(policy, values));
+        });
+    };
+    bench_select("random", random);
+    bench_select("greedy", greedy);
+    bench_select("egreedy", egreedy);
+    {
+        SilenceCout silence;
+        bench_select("ucb", ucb);
+    }
+
+    //
+    // Episodes and learners
+    //
+    const unsigned long long EPISODES = 200000;
+    {
+        EpsilonGreedyPolicy policy(0.1);
+        Agent agent(policy);
+        Episode episode;
+        bench("generateEpisode/egreedy", EPISODES, [&]() {
+            for (unsigned long long i=0; i<EPISODES; i++)
+                generateEpisode(agent, policy, episode);
+        });
+    }
+    {
+        EpsilonGreedyPolicy policy(0.1);
+        Agent agent(policy);
+        bench("onPolicyLearner/egreedy", EPISODES, [&]() {
+            onPolicyLearner<EpsilonGreedyPolicy>(&agent, EPISODES);
+        });
+        bench("offPolicyLearner/egreedy", EPISODES, [&]() {
+            offPolicyLearner<EpsilonGreedyPolicy>(&agent, EPISODES);
+        });
+        bench("onPolicyBatchLearner/egreedy/256", EPISODES, [&]() {
+            onPolicyBatchLearner<EpsilonGreedyPolicy>(&agent, EPISODES, 256);
+        });
+        bench("offPolicyBatchLearner/egreedy/256", EPISODES, [&]() {
+            offPolicyBatchLearner<EpsilonGreedyPolicy>(&agent, EPISODES, 256);
+        });
+        bench("tdLearner/egreedy/sarsa", EPISODES, [&]() {
+            tdLearner<EpsilonGreedyPolicy>(&agent, EPISODES, Sarsa);
+        });
+        bench("tdLearner/egreedy/expected", EPISODES, [&]() {
+            tdLearner<EpsilonGreedyPolicy>(&agent, EPISODES, ExpectedSarsa);
+        });
+        bench("tdLearner/egreedy/qlearning", EPISODES, [&]() {
+            tdLearner<EpsilonGreedyPolicy>(&agent, EPISODES, QLearning);
+        });
+        bench("tdLearner/egreedy/sarsa/0.8", EPISODES, [&]() {
+            tdLearner<EpsilonGreedyPolicy>(&agent, EPISODES, Sarsa, DEFAULT_ALPHA, 0.8);
+        });
+    }
+
+    return 0;
+}
@@ -4,10 +4,31 @@
 
 using namespace std;
 
+// The player's actions.
+//
+// The actions are ordered so that the actions valid in a state are
+// always a prefix of the enum, see State::numActions():
+//    * Hit, Stay - always valid.
+//    * Double    - only as the first action of a hand.
+//    * Surrender - only as the first action of a dealt hand.
+//    * Split     - only as the first action of a dealt pair.
+//
 enum Action {
     Hit,
-    Stay
+    Stay,
+    Double,
+    Surrender,
+    Split
 };
+const int NUM_ACTIONS = 5;
+
+// Gets the single letter abbreviation of an action, as used in the
+// policy matrix.
+//
+inline char actionLetter(Action a) {
+    static const char letters[NUM_ACTIONS] = {'H', 'S', 'D', 'R', 'P'};
+    return letters[a];
+}
 /*
 void printAction(const Action& a) {
     cout << "Action: ";
@@ -23,4 +44,4 @@ void printAction(const Action& a) {
     }
     cout << endl;
 }
-*/
\ No newline at end of file
+*/
@@ -5,9 +5,11 @@
 #include <utility>
 
 #include "action.hpp"
+#include "environment.hpp"
 #include "policy.hpp"
 #include "state.hpp"
 #include "reward.hpp"
+#include "valuetable.hpp"
 
 using namespace std;
 
@@ -16,50 +18,164 @@ using namespace std;
 // and choose the best actions accordingly.
 class Agent {
     private:
-        // Comparator for state-action hash
         // Estimates the value for each state action pair by
         // averaging the returns experienced.
-        map<pair<State, Action>, AvgReturn*>* m_values;
+        ValueTable* m_values;
+        // Whether the agent deallocates the value estimates.
+        bool m_owns_values;
         // Policy used by the agent to generate episodes.
         Policy& m_policy;
     public:
         // Constructors
-        explicit Agent(Policy& policy) : m_policy(policy) {
-            m_values = new map<pair<State, Action>, AvgReturn*>;
-        }
+        //
+        // By default the estimates are kept in a dense table.
+        // The agent takes ownership of the given value store, unless it is
+        // given by reference, in which case it may be shared between agents.
+        explicit Agent(Policy& policy) : 
+            m_values(new DenseValueTable), 
+            m_owns_values(true),
+            m_policy(policy) {}
+        explicit Agent(ValueTable* values, Policy& policy) : 
+            m_values(values), 
+            m_owns_values(true),
+            m_policy(policy) {}
+        explicit Agent(ValueTable& values, Policy& policy) : 
+            m_values(&values), 
+            m_owns_values(false),
+            m_policy(policy) {}
         explicit Agent(map<pair<State, Action>, AvgReturn*>* values, 
-                        Policy& policy) : m_policy(policy), m_values(values) {}
+                        Policy& policy) : 
+            m_values(new MapValueTable(values)), 
+            m_owns_values(true),
+            m_policy(policy) {}
         // Deconstructor
         ~Agent() {
             // Deallocate the value estimates.
-            for (auto item : *m_values)
-                delete(item.second);
-            // Deallocate the value map
-            delete(m_values);
+            if (m_owns_values) delete(m_values);
         }
         // Gets the agent's policy.
         Policy& policy() {return m_policy;}
+        // Gets the agent's value estimates.
+        ValueTable& values() {return *m_values;}
         // Gets the value estimate corresponding to the given
         // state-action pair.
         AvgReturn* getStateActionValue(const State* state, const Action action);
         // Updates the value estimate corresponding to the given state-action pair.
         void updateStateActionValue(const State* state, const Action action, const double rtrn);
         // Updates the value estimate corresponding to the given state-action pair.
-        // The 'strength' of the update is scaled by the weight parameter alpha.
+        // The return is averaged with the given weight, e.g. an importance
+        // sampling weight.
         void weightedUpdateStateActionValue(const State* state, 
                                       const Action action, 
                                       const double rtrn,
-                                      const double alpha);
-        // Gets the values for action in the given state.
-        map<Action, AvgReturn*> getActionValues(const State* state);
+                                      const double weight);
+        // Steps the value estimate corresponding to the given state-action
+        // pair towards the target by a constant step size alpha. The weight
+        // is added to the estimate's weight, which counts the steps.
+        void stepStateActionValue(const State* state,
+                                  const Action action,
+                                  const double target,
+                                  const double alpha,
+                                  const double weight=1);
+        // Gets a view of the values for each action in the given state.
+        ActionValues getActionValues(const State* state) {
+            return m_values->getActions(*state);
+        }
         // Gets the probability of the agent taking a given action in a given state.
-        double actionProbability(const Action action, const State* state);
+        double actionProbability(const Action action, const State* state) {
+            return actionProbability(m_policy, action, state);
+        }
+        template <class PolicyT>
+        double actionProbability(PolicyT& policy, const Action action, const State* state);
         // Use the agent's policy and state-action value estimates to select an action.
-        Action getAction(const State* state);
+        Action getAction(const State* state) {
+            return getAction(m_policy, state);
+        }
+        template <class PolicyT>
+        Action getAction(PolicyT& policy, const State* state);
         // Function through which the agent interacts with the environment.
-        Reward act(const State* state, Action& _action, State** _state);
+        double act(const State* state, Action& _action, double& _probability,
+                   State& _state, bool& _terminal) {
+            return act(m_policy, state, _action, _probability, _state, _terminal);
+        }
+        template <class PolicyT>
+        double act(PolicyT& policy, const State* state, Action& _action, 
+                   double& _probability, State& _state, bool& _terminal);
         // Gets the greedy action based on the agent's state-action value estimates
         Action getGreedyAction(const State* state);
+        // Read-only access to the estimates, used for reporting.
+        // Unlike the functions above, these never create estimates.
+        const AvgReturn* peekStateActionValue(const State* state, const Action action) const {
+            return m_values->peek(*state, action);
+        }
+        bool peekGreedyAction(const State* state, Action& _action) const;
         // Print policy preferences in a matrix format.
-        void printPolicyMatrix();
-};
\ No newline at end of file
+        void printPolicyMatrix() const;
+};
+
+// The templated functions take the agent's policy as its concrete type,
+// so that action selection can be inlined into the training loop.
+// The given policy must be the agent's policy.
+
+// This function returns the probability of the agent taking a given action in a given state.
+//
+template <class PolicyT>
+double Agent::actionProbability(PolicyT& policy, const Action action, const State* state) {
+    return selectionProbability(policy, action, getActionValues(state));
+}
+
+// Given a state, the agent must use its policy and state-action value
+// estimates to select a valid action.
+//
+// Input:
+//    - state
+// Output:
+//    - action to be taken determined by the agent's policy.
+//
+template <class PolicyT>
+Action Agent::getAction(PolicyT& policy, const State* state) {
+    // Use the policy to select an action.
+    return selectAction(policy, getActionValues(state));
+}
+
+// Given a state, the agent must use its policy to select an action.
+// This action then transfoms the state to the next state and a reward
+// is recieved.
+//
+// Input:
+//    - state: the current state
+// Output:
+//    - _action: the action taken by the agent
+//    - _probability: the probability the policy had of taking the action
+//    - _state: the next state after the action has been taken
+//    - _terminal: whether the episode has ended
+//    - Returns the reward recieved
+//
+template <class PolicyT>
+double Agent::act(PolicyT& policy, const State* state, Action& _action, 
+                  double& _probability, State& _state, bool& _terminal) {
+    // Use the action to transform the state to the next state.
+    _action = selectAction(policy, getActionValues(state), _probability);
+    return transform(state, _action, _state, _terminal);
+}
+
+// Gets a policy as its concrete type.
+// Aborts if the policy isn't a PolicyT.
+//
+template <class PolicyT>
+PolicyT& policyAs(Policy& policy) {
+    PolicyT* concrete = dynamic_cast<PolicyT*>(&policy);
+    // Handle error
+    if (concrete == nullptr) {
+        cerr << "Policy has the wrong type!" << endl;
+        abort();
+    }
+    return *concrete;
+}
+
+// Gets the agent's policy as its concrete type.
+//
+template <class PolicyT>
+PolicyT& policyAs(Agent& agent) {
+    return policyAs<PolicyT>(agent.policy());
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+// This file declares saving and loading of training checkpoints.
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "agent.hpp"
+
+using namespace std;
+
+// Checkpoint file layout, version 4.
+//
+// The file is a fixed-size header followed by one fixed-size record per
+// entry of the dense value table, in table order. Version 2 added the
+// double, surrender and split actions, which changed the table layout.
+// Version 3 stores each estimate as its mean and total weight. Version 4
+// drops the separate off-policy weight, which is now the estimate's
+// total weight. Every field is a
+// fixed-width little-endian value at an 8 byte aligned offset, so on a
+// little-endian host the file can be memory mapped and read in place.
+// Big-endian hosts swap the byte order of each field when saving and
+// loading.
+//
+const char CHECKPOINT_MAGIC[8] = {'R', 'L', 'B', 'J', 'C', 'K', 'P', 'T'};
+const uint32_t CHECKPOINT_VERSION = 4;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    // Number of records following the header.
+    uint32_t num_entries;
+    // Number of episodes trained so far.
+    uint64_t episodes;
+    // Policy counters, see Policy::getCounters.
+    uint64_t policy_counters[NUM_POLICY_COUNTERS];
+    // Text state of the main thread's random number generator.
+    char rng_state[64];
+};
+
+struct CheckpointEntry {
+    double value;
+    double weight;
+};
+
+// Note - buffered dealer outcomes and the order of the cards in a shoe
+//        aren't saved, so a resumed run draws different episodes than an
+//        uninterrupted run would have.
+
+// Saves the agent's training state to the given path.
+// The file is written to a temporary path and then renamed over the
+// destination, so a preempted save never corrupts the last checkpoint.
+bool saveCheckpoint(Agent& agent, unsigned long long episodes, const string& path);
+
+// Loads the agent's training state from the given path.
+// Outputs the number of episodes trained before the checkpoint.
+bool loadCheckpoint(Agent& agent, unsigned long long& episodes, const string& path);
+
+// Loads only the value estimates saved in the checkpoint, e.g. to
+// compare against a reference strategy.
+bool loadCheckpointValues(Agent& agent, const string& path);
@@ -0,0 +1,87 @@
+// This file declares the convergence tracking used to stop training early.
+#pragma once
+
+#include "agent.hpp"
+#include "progress.hpp"
+#include "valuetable.hpp"
+
+// Convergence of the agent's estimates between two checks.
+//
+// Only the states which can be reached from a dealt hand are counted,
+// see ConvergenceTracker.
+//
+struct Convergence {
+    // Number of states whose greedy action changed.
+    int flips;
+    // Largest absolute change of any state-action value.
+    double max_delta;
+    // Fraction of states whose greedy action matches the reference
+    // strategy, or -1 without a reference.
+    double agreement;
+    // Largest absolute difference between the value of splitting a pair
+    // and the reference's, or -1 without a reference. Split values are
+    // the only ones made of several hands' returns, so they're checked
+    // on their own.
+    double split_error;
+};
+
+// When a run is stopped early.
+//
+// A check is stable if no greedy action flipped and no value changed by
+// more than max_delta. Training stops after patience consecutive stable
+// checks, or once the agreement with the reference reaches min_agreement.
+//
+struct StoppingCriterion {
+    // Zero never stops on stability.
+    int patience;
+    double max_delta;
+    // Above one never stops on agreement.
+    double min_agreement;
+};
+
+// Tracks the convergence of the agent's estimates at every report, and
+// asks the learners to stop once the stopping criterion is met.
+//
+// Each check compares the agent's greedy actions and values to those at
+// the previous check, so a check costs a single pass over the table.
+// The first check only records the agent's estimates.
+//
+// Only the states reachable from a dealt hand are tracked, since the
+// other states' estimates never change.
+//
+class ConvergenceTracker : public TrainingObserver {
+    private:
+        StoppingCriterion m_criterion;
+        // Greedy action of each state, by index, in the reference strategy.
+        bool m_has_reference;
+        int m_reference[NUM_STATES];
+        // Value of splitting each pair, by state index, in the reference.
+        double m_reference_split[NUM_STATES];
+        // Whether each state, by index, is reachable from a dealt hand.
+        bool m_reachable[NUM_STATES];
+        // Greedy actions and values at the previous check.
+        // States without an estimate have the action -1.
+        int m_actions[NUM_STATES];
+        double m_values[NUM_STATE_ACTIONS];
+        int m_checks;
+        // Number of consecutive stable checks.
+        int m_stable;
+        Convergence m_last;
+        bool m_stop;
+        unsigned long long m_stopped_at;
+    public:
+        // Constructor
+        // The reference strategy is the greedy policy of the reference
+        // agent's estimates, which are only read by the constructor.
+        // Its split values are the exact ones if the reference was
+        // solved with valueIterationSolver.
+        ConvergenceTracker(unsigned long long interval, const StoppingCriterion& criterion,
+                           const Agent* reference=nullptr);
+        // Checks the agent's convergence and prints the metrics.
+        void onProgress(const Agent& agent, const Progress& progress);
+        bool shouldStop() const {return m_stop;}
+        // Gets the metrics of the last check.
+        const Convergence& last() const {return m_last;}
+        // Gets the iteration of the run at which the tracker asked to stop.
+        unsigned long long stoppedAt() const {return m_stopped_at;}
+};
@@ -0,0 +1,115 @@
+// This file declares the batched dealer simulation used by the environment.
+#pragma once
+
+#include <cstdint>
+
+using namespace std;
+
+// Ways the environment can play out the dealer's hand.
+//    * SequentialDealer - deal one card at a time through the dealer's state.
+//    * BatchedDealer    - draw outcomes from batches of dealer hands
+//                         simulated ahead of time for each up card.
+//    * AliasDealer      - draw outcomes from the exact distribution of the
+//                         dealer's final count in constant time.
+//    * ExpectedDealer   - don't play out the dealer's hand, instead reward
+//                         the player with the exact expected reward.
+//
+// Note - all but the sequential dealer rely on the dealer's outcome
+//        being independent of the player's cards, which only holds
+//        with an infinite deck. Hands dealt from a shoe are always
+//        played out sequentially.
+//
+enum DealerMode {
+    SequentialDealer,
+    BatchedDealer,
+    AliasDealer,
+    ExpectedDealer
+};
+
+// Number of dealer hands simulated per batch.
+const int DEALER_BATCH_SIZE = 256;
+
+// Dealer up cards are in [2, 11].
+const int MIN_UP_CARD = 2;
+const int NUM_UP_CARDS = 10;
+
+// The dealer's final outcomes are a count in [17, 21] or a bust.
+// Busts are reported as a count of 22.
+const int NUM_DEALER_OUTCOMES = 6;
+const int DEALER_BUST = 22;
+
+// Largest player count with an entry in the expected reward table.
+// Any count above 21 is a bust.
+const int MAX_PLAYER_COUNT = 31;
+
+// Exact distribution of the dealer's final count given the up card,
+// with cards dealt from an infinite deck.
+//
+// The distribution is used for two things:
+//    1) the player's exact expected reward for standing on a count.
+//    2) drawing the dealer's final count in O(1) with Vose's alias method.
+//
+class DealerDistribution {
+    private:
+        // P(final outcome | up card)
+        double m_probs[NUM_UP_CARDS][NUM_DEALER_OUTCOMES];
+        // Expected reward for the player's final count and the up card.
+        double m_expected[MAX_PLAYER_COUNT+1][NUM_UP_CARDS];
+        // Alias tables, one per up card.
+        double m_alias_probs[NUM_UP_CARDS][NUM_DEALER_OUTCOMES];
+        int m_aliases[NUM_UP_CARDS][NUM_DEALER_OUTCOMES];
+    public:
+        // Computes the tables.
+        DealerDistribution();
+        // Gets the probability of the dealer finishing with the given count.
+        double probability(int up_card, int final_count) const;
+        // Gets the player's expected reward for finishing with the given count.
+        double expectedReward(int player_count, int up_card) const {
+            if (player_count > MAX_PLAYER_COUNT) player_count = MAX_PLAYER_COUNT;
+            return m_expected[player_count][up_card - MIN_UP_CARD];
+        }
+        // Draws the dealer's final count for the up card.
+        int sample(int up_card) const;
+};
+
+// Table computed once at startup.
+extern const DealerDistribution dealer_distribution;
+
+// Plays out n dealer hands at once.
+//
+// Hands are stored as a structure of arrays and every hand draws a card
+// each round until all of them are standing. The per-hand math is branch
+// free and each hand has its own random stream, so the rounds vectorize.
+//
+// Input:
+//    - up_cards: the dealer's face up card for each hand.
+//    - n: number of hands, at most DEALER_BATCH_SIZE.
+// Output:
+//    - final_counts: the dealer's final count for each hand.
+//
+void playDealerBatch(const int* up_cards, int* final_counts, int n);
+
+// Buffers of simulated dealer outcomes, one per up card.
+// A buffer is refilled with a whole batch once it has been used up.
+//
+class DealerOutcomes {
+    private:
+        int m_counts[NUM_UP_CARDS][DEALER_BATCH_SIZE];
+        int m_cursor[NUM_UP_CARDS];
+        // Simulates a new batch of outcomes for the up card.
+        void refill(int up_card);
+    public:
+        // Constructor
+        // Buffers start empty and are filled on first use.
+        DealerOutcomes() {
+            for (int i=0; i<NUM_UP_CARDS; i++)
+                m_cursor[i] = DEALER_BATCH_SIZE;
+        }
+        // Gets the dealer's final count for a hand with the given up card.
+        int next(int up_card) {
+            int i = up_card - MIN_UP_CARD;
+            if (m_cursor[i] == DEALER_BATCH_SIZE)
+                refill(up_card);
+            return m_counts[i][m_cursor[i]++];
+        }
+};
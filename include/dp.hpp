@@ -0,0 +1,9 @@
+#pragma once
+
+#include "agent.hpp"
+
+// This function computes the exact optimal state-action values for the 
+// environment with value iteration, and stores them in the agent's estimates.
+//
+// Returns the number of sweeps needed to converge.
+int valueIterationSolver(Agent* agent, double theta=1e-12);
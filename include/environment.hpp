@@ -5,17 +5,24 @@
 #include <stack>
 
 #include "action.hpp"
-#include "agent.hpp"
+#include "dealer.hpp"
 #include "reward.hpp"
+#include "start.hpp"
 #include "state.hpp"
 
 using namespace std;
 
+void useDealer(DealerMode mode);
+void useStarts(StartMode mode);
+void useShoe(int ndecks, double penetration);
 int dealCard();
 bool checkTerminal(State* state);
 void setStartingState(State* state);
 set<Action> validActions(const State* state);
+int pairCard(const State* state);
+bool dealSplitHand(const State* pair, State& _hand);
 Reward endEpisode(int player_count, int dealer_count);
-Reward transform(const State* state, const Action& action, State** _state);
+double transform(const State* state, const Action& action, State& _state, bool& _terminal);
 Reward determineWinner(int player, int dealer);
-Reward endGame(int player_count, int dealer_count);
\ No newline at end of file
+Reward endGame(int player_count, int dealer_count);
+double finalReward(int player_count, int dealer_count);
\ No newline at end of file
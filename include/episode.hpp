@@ -1,22 +1,103 @@
 #pragma once
 
-#include <stack>
 #include <tuple>
 
 #include "agent.hpp"
 #include "action.hpp"
+#include "environment.hpp"
 #include "reward.hpp"
 #include "state.hpp"
 
 using namespace std;
 
-// Each timestep, t, in the episode is represented by the triplet,
-// (S_t, A_t, R_t+1) where R_t+1 is the reward experienced after
-// taking the action, A_t, in the state, S_t. 
-using Timestep = tuple<State*, Action, Reward>;
-// Episodes are represented by the (state, action, reward) tuple
-// for each timestep:
-// (S_0, A_0, R_1), ..., (S_T-1, A_T-1, R_T)
-using Episode = stack<Timestep>;
+// Upper bound on the number of hands in an episode, the dealt hand and
+// the two hands made by splitting it. Split hands can't be split again.
+const int MAX_HANDS = 3;
+
+// Upper bound on the number of timesteps in an episode.
+// Every hit adds at least one to the player's hard count, 
+// so a hand can't last more than about 20 actions.
+const int MAX_EPISODE_LENGTH = 64;
+
+// Each timestep, t, in the episode is represented by the tuple,
+// (S_t, A_t, R_t+1, b(A_t|S_t)) where R_t+1 is the reward experienced
+// after taking the action, A_t, in the state, S_t, and b(A_t|S_t) is
+// the probability the behavior policy had of taking it.
+//
+// Rewards are real valued so they can hold expected rewards.
+// The probability is recorded when the action is chosen, so learners
+// never have to ask the policy again.
+using Timestep = tuple<State, Action, double, double>;
+
+// Episodes are represented by the (state, action, reward, probability)
+// tuple for each timestep:
+// (S_0, A_0, R_1, b_0), ..., (S_T-1, A_T-1, R_T, b_T-1)
+//
+// The timesteps are stored by value in a fixed-capacity buffer so
+// an episode can be reused across iterations without allocating.
+//
+// The timesteps of each hand are contiguous. A split pair's hand ends
+// with the split, whose reward is the total reward of the two split
+// hands, and is followed by the split hands. Returns are only ever
+// accumulated within a hand.
+//
+class Episode {
+    private:
+        Timestep m_timesteps[MAX_EPISODE_LENGTH];
+        // m_ends[h] is one past the last timestep of hand h.
+        int m_ends[MAX_HANDS];
+        int m_size;
+        int m_nhands;
+    public:
+        // Constructor
+        Episode() : m_size(0), m_nhands(0) {}
+        // Appends a timestep to the current hand.
+        void push(const Timestep& t);
+        // Ends the current hand, the next timestep starts a new one.
+        void endHand() {m_ends[m_nhands++] = m_size;}
+        // Removes every timestep.
+        void clear() {m_size = 0; m_nhands = 0;}
+        bool empty() const {return m_size == 0;}
+        int size() const {return m_size;}
+        // Gets the i-th timestep from the start of the episode.
+        Timestep& operator[](int i) {return m_timesteps[i];}
+        // Number of hands, and the position and length of the h-th hand.
+        int hands() const {return m_nhands;}
+        int handStart(int h) const {return h == 0 ? 0 : m_ends[h-1];}
+        int handLength(int h) const {return m_ends[h] - handStart(h);}
+};
+
 // Generate a episode trajectory with the given agent.
-Episode* generateEpisode(Agent& agent);
\ No newline at end of file
+// The given episode is cleared and overwritten.
+//
+// The agent's policy can be given as its concrete type so that action
+// selection is inlined into the episode loop.
+template <class PolicyT>
+void generateEpisode(Agent& agent, PolicyT& policy, Episode& episode);
+inline void generateEpisode(Agent& agent, Episode& episode) {
+    generateEpisode(agent, agent.policy(), episode);
+}
+
+// Deals both hands of a split pair and plays out each one with the
+// given function, which is called with the hand's starting state and
+// returns what the hand is worth to the split.
+//
+// A hand dealt 21 stays without acting, and is worth its final reward.
+// Both the episodes and the TD learners split through this function,
+// so that every learner sees the same split hands.
+//
+// Output:
+//    - The total worth of the split hands, the split's reward.
+//
+template <typename PlayHand>
+double playSplitHands(const State& pair, PlayHand play) {
+    double total = 0;
+    State hand;
+    for (int h=0; h<2; h++) {
+        if (dealSplitHand(&pair, hand))
+            total += finalReward(hand.count(), hand.dealer());
+        else
+            total += play(hand);
+    }
+    return total;
+}
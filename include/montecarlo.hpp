@@ -1,9 +1,67 @@
 #pragma once
 
 #include "agent.hpp"
+#include "episode.hpp"
+#include "progress.hpp"
+#include "replay.hpp"
+
+// The learners are templated on the type of the agent's policy.
+// When the type is known at compile time, action selection is inlined into
+// the training loop. The default, Policy, dispatches through the virtual
+// interface.
+//
+// If an observer is given, it is called with the agent's progress
+// every observer->interval() iterations.
+
+// How the off-policy learners weight the returns of the behavior
+// policy, see offPolicyUpdate:
+//    - OrdinarySampling: the average of the importance weighted returns.
+//    - WeightedSampling: the average of the returns, weighted by their
+//      importance sampling ratios.
+//    - PerDecisionSampling: the average of the returns where each reward
+//      is only weighted by the ratios of the actions before it.
+//
+// In every mode, the reward of a split is the total of the split hands'
+// rewards, each sampled like a return with the ratios of its own hand's
+// actions.
+enum ImportanceSampling {OrdinarySampling, WeightedSampling, PerDecisionSampling};
+
+// Sets the importance sampling used by the off-policy learners.
+// Weighted sampling is used by default.
+void useImportanceSampling(ImportanceSampling mode);
 
 // This function performs on-policy monte carlo policy evaluation and improvement.
-void onPolicyLearner(Agent* agent, unsigned long long niters, double gamma=1);
+template <class PolicyT = Policy>
+void onPolicyLearner(Agent* agent, unsigned long long niters, double gamma=1,
+                     TrainingObserver* observer=nullptr);
 
 // This function performs off-policy monte carlo policy evaluation and improvement.
-void offPolicyLearner(Agent* agent, unsigned long long niters, double gamma=1);
\ No newline at end of file
+template <class PolicyT = Policy>
+void offPolicyLearner(Agent* agent, unsigned long long niters, double gamma=1,
+                      TrainingObserver* observer=nullptr);
+
+// Batch variants of the learners. Each round generates up to batch
+// episodes into a replay buffer, then applies all of their updates.
+template <class PolicyT = Policy>
+void onPolicyBatchLearner(Agent* agent, unsigned long long niters, int batch,
+                          double gamma=1, TrainingObserver* observer=nullptr);
+template <class PolicyT = Policy>
+void offPolicyBatchLearner(Agent* agent, unsigned long long niters, int batch,
+                           double gamma=1, TrainingObserver* observer=nullptr);
+
+// Applies the on-policy update for a single hand, given as its
+// timesteps in order, for every hand of an episode which is consumed,
+// or for every hand in a replay buffer.
+void onPolicyUpdate(Agent* agent, const Timestep* steps, int n, double gamma=1);
+void onPolicyUpdate(Agent* agent, Episode& episode, double gamma=1);
+void onPolicyUpdate(Agent* agent, const ReplayBuffer& buffer, double gamma=1);
+
+// Applies the off-policy update for every hand of an episode which is
+// consumed, or for every hand in a replay buffer. The behavior
+// probabilities are those recorded in the timesteps.
+//
+// Unlike the on-policy update, the hands of an episode can't be updated
+// on their own, since a split's reward is sampled with the ratios of
+// the split hands' actions.
+void offPolicyUpdate(Agent* agent, Episode& episode, double gamma=1);
+void offPolicyUpdate(Agent* agent, const ReplayBuffer& buffer, double gamma=1);
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "agent.hpp"
+#include "progress.hpp"
+
+// These functions spread monte carlo episode generation across worker threads.
+//
+// Each worker trains a private copy of the agent with its own independently
+// seeded random stream. The workers' returns are merged into the agent's
+// estimates once every worker has finished.
+//
+// If an observer is given, training runs in rounds of observer->interval()
+// episodes and the workers are merged before each report.
+
+// Like the serial learners, they are templated on the type of the agent's policy.
+
+// Parallel on-policy monte carlo policy evaluation and improvement.
+template <class PolicyT = Policy>
+void parallelOnPolicyLearner(Agent* agent, unsigned long long niters, 
+                             unsigned nthreads, double gamma=1,
+                             TrainingObserver* observer=nullptr);
+
+// Parallel off-policy monte carlo policy evaluation and improvement.
+template <class PolicyT = Policy>
+void parallelOffPolicyLearner(Agent* agent, unsigned long long niters, 
+                              unsigned nthreads, double gamma=1,
+                              TrainingObserver* observer=nullptr);
+
+// The Hogwild learners instead have every worker update the agent's
+// estimates directly, without locks. The agent's value table must be
+// concurrent (see SharedValueTable). Runs are not reproducible, since
+// the result depends on how the workers' updates interleave.
+
+// Hogwild on-policy monte carlo policy evaluation and improvement.
+template <class PolicyT = Policy>
+void hogwildOnPolicyLearner(Agent* agent, unsigned long long niters, 
+                            unsigned nthreads, double gamma=1,
+                            TrainingObserver* observer=nullptr);
+
+// Hogwild off-policy monte carlo policy evaluation and improvement.
+template <class PolicyT = Policy>
+void hogwildOffPolicyLearner(Agent* agent, unsigned long long niters, 
+                             unsigned nthreads, double gamma=1,
+                             TrainingObserver* observer=nullptr);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "agent.hpp"
+#include "progress.hpp"
+
+// These functions pipeline monte carlo training across threads.
+//
+// nthreads generator threads simulate episodes with a private snapshot
+// of the agent's estimates and a copy of its policy. They pass batches of
+// episodes through bounded lock-free queues to the calling thread, which
+// applies the usual on- or off-policy update to the agent. The updates
+// are therefore single-threaded and exact, while the simulation uses
+// every core.
+//
+// Every publish_every episodes, the updater sends each generator a new
+// snapshot of the agent's estimates. The generators' behavior lags the
+// agent's estimates by up to that many episodes, and runs are not
+// reproducible, since the lag depends on thread timing. The off-policy
+// update weights each episode by the behavior probabilities recorded by
+// its generator, so the lag doesn't bias the importance sampling.
+//
+// Like the other learners, they are templated on the type of the agent's policy.
+
+// Default number of episodes applied between snapshots.
+const unsigned long long DEFAULT_PUBLISH_EVERY = 4096;
+
+// Pipelined on-policy monte carlo policy evaluation and improvement.
+// Each queued batch holds up to batch episodes.
+template <class PolicyT = Policy>
+void pipelinedOnPolicyLearner(Agent* agent, unsigned long long niters,
+                              unsigned nthreads, int batch, double gamma=1,
+                              unsigned long long publish_every=DEFAULT_PUBLISH_EVERY,
+                              TrainingObserver* observer=nullptr);
+
+// Pipelined off-policy monte carlo policy evaluation and improvement.
+template <class PolicyT = Policy>
+void pipelinedOffPolicyLearner(Agent* agent, unsigned long long niters,
+                               unsigned nthreads, int batch, double gamma=1,
+                               unsigned long long publish_every=DEFAULT_PUBLISH_EVERY,
+                               TrainingObserver* observer=nullptr);
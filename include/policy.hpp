@@ -4,27 +4,47 @@
 #include "action.hpp"
 #include "reward.hpp"
 #include "state.hpp"
+#include "valuetable.hpp"
 
-#include <map>
+#include <cfloat>
+#include <cmath>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#include "seed.hpp"
 
 using namespace std;
 
+// Number of counters a policy can save with a checkpoint.
+const int NUM_POLICY_COUNTERS = 2;
+
 // Base class
 //
 class Policy {
     public:
         // Constructor
         Policy() {}
+        virtual ~Policy() {}
         // Action selection:
-        // - Input: value estimates for state-action pairs
-        // - Output: state-action pair from the input set.
-        virtual Action select(map<Action, AvgReturn*> values) = 0;
+        // - Input: view of the value estimates for the actions in a state
+        // - Output: an action from the input view.
+        virtual Action select(const ActionValues& values) = 0;
         // Action probabilities:
         // - Returns the probability of choosing the action given the values.
-        virtual double actionProbability(Action action, map<Action, AvgReturn*> values) = 0;
+        //   Never changes the policy's state.
+        virtual double actionProbability(Action action, const ActionValues& values) = 0;
+        // Action selection that also outputs the probability the
+        // selected action had of being chosen, from the same draw.
+        virtual Action selectWithProbability(const ActionValues& values, double& _probability) = 0;
         // Prints policy stats.
         virtual void printStats() = 0;
+        // Returns a heap allocated copy of the policy.
+        virtual Policy* clone() const = 0;
+        // Gets and sets the policy's internal counters,
+        // so they can be saved with a checkpoint.
+        virtual void getCounters(unsigned long long[NUM_POLICY_COUNTERS]) const {}
+        virtual void setCounters(const unsigned long long[NUM_POLICY_COUNTERS]) {}
 };
 
 // Select each action with equal probability.
@@ -32,9 +52,11 @@ class Policy {
 class RandomPolicy : public virtual Policy {
     public:
         RandomPolicy() {}
-        Action select(map<Action, AvgReturn*> values);
-        double actionProbability(Action action, map<Action, AvgReturn*> values);
+        Action select(const ActionValues& values);
+        double actionProbability(Action action, const ActionValues& values);
+        Action selectWithProbability(const ActionValues& values, double& _probability);
         void printStats() { cout << endl; }
+        Policy* clone() const { return new RandomPolicy(*this); }
 };
 
 // Select the policy with the highest average return.
@@ -42,9 +64,11 @@ class RandomPolicy : public virtual Policy {
 class GreedyPolicy : public virtual Policy {
     public:
         GreedyPolicy() {}
-        Action select(map<Action, AvgReturn*> values);
-        double actionProbability(Action action, map<Action, AvgReturn*> values);
+        Action select(const ActionValues& values);
+        double actionProbability(Action action, const ActionValues& values);
+        Action selectWithProbability(const ActionValues& values, double& _probability);
         void printStats() { cout << endl; }
+        Policy* clone() const { return new GreedyPolicy(*this); }
 };
 
 // Epsilon-greedy policy:
@@ -57,10 +81,18 @@ class EpsilonGreedyPolicy : public virtual Policy{
         unsigned long long n_total; // number of times select has been called.
         unsigned long long n_greedy; // number of times the greedy action has been selected.
     public:
-        explicit EpsilonGreedyPolicy(double e) : m_e(e) {}
-        Action select(map<Action, AvgReturn*> values);
-        double actionProbability(Action action, map<Action, AvgReturn*> values);
+        explicit EpsilonGreedyPolicy(double e) : m_e(e), n_total(0), n_greedy(0) {}
+        Action select(const ActionValues& values);
+        double actionProbability(Action action, const ActionValues& values);
+        Action selectWithProbability(const ActionValues& values, double& _probability);
         void printStats();
+        Policy* clone() const { return new EpsilonGreedyPolicy(*this); }
+        void getCounters(unsigned long long counters[NUM_POLICY_COUNTERS]) const {
+            counters[0] = n_total; counters[1] = n_greedy;
+        }
+        void setCounters(const unsigned long long counters[NUM_POLICY_COUNTERS]) {
+            n_total = counters[0]; n_greedy = counters[1];
+        }
 };
 
 // Upper-Confidence Bound greedy policy.
@@ -81,7 +113,238 @@ class UpperConfidenceBoundPolicy : public GreedyPolicy {
     public:
         // Initialize starting time to 1 because ln(0) = NaN
         explicit UpperConfidenceBoundPolicy(double C) : m_t(1), m_C(C) {}
-        Action select(map<Action, AvgReturn*> values);
-        double actionProbability(Action action, map<Action, AvgReturn*> values);
+        // Gets the action with the greatest upper confidence bound at
+        // the current time, without advancing it.
+        Action bestAction(const ActionValues& values) const;
+        Action select(const ActionValues& values);
+        double actionProbability(Action action, const ActionValues& values);
+        Action selectWithProbability(const ActionValues& values, double& _probability);
         void printStats() { cout << endl; }
+        Policy* clone() const { return new UpperConfidenceBoundPolicy(*this); }
+        void getCounters(unsigned long long counters[NUM_POLICY_COUNTERS]) const {
+            counters[0] = m_t;
+        }
+        void setCounters(const unsigned long long counters[NUM_POLICY_COUNTERS]) {
+            m_t = counters[0];
+        }
 };
+
+// Adds the counts made by copies of the policy, e.g. by worker threads,
+// to the policy's own counters. The copies must have been cloned from
+// the policy, and the policy must not have been used since.
+//
+inline void mergeCounters(Policy& policy, const vector<Policy*>& copies) {
+    unsigned long long base[NUM_POLICY_COUNTERS] = {};
+    unsigned long long total[NUM_POLICY_COUNTERS] = {};
+    policy.getCounters(base);
+    policy.getCounters(total);
+    for (const Policy* copy : copies) {
+        unsigned long long counters[NUM_POLICY_COUNTERS] = {};
+        copy->getCounters(counters);
+        for (int i=0; i<NUM_POLICY_COUNTERS; i++)
+            total[i] += counters[i] - base[i];
+    }
+    policy.setCounters(total);
+}
+
+// Applies the given macro to every policy type.
+// Used to explicitly instantiate code templated on the policy type.
+#define FOR_EACH_POLICY(X) \
+    X(Policy) \
+    X(RandomPolicy) \
+    X(GreedyPolicy) \
+    X(EpsilonGreedyPolicy) \
+    X(UpperConfidenceBoundPolicy)
+
+// Calls the policy's select function.
+// When the policy's concrete type is known at compile time, the call is
+// made without virtual dispatch so that it can be inlined.
+//
+template <class PolicyT>
+inline Action selectAction(PolicyT& policy, const ActionValues& values) {
+    if constexpr (is_abstract_v<PolicyT>)
+        return policy.select(values);
+    else
+        return policy.PolicyT::select(values);
+}
+
+// Calls the policy's actionProbability function.
+// When the policy's concrete type is known at compile time, the call is
+// made without virtual dispatch so that it can be inlined.
+//
+template <class PolicyT>
+inline double selectionProbability(PolicyT& policy, Action action, 
+                                   const ActionValues& values) {
+    if constexpr (is_abstract_v<PolicyT>)
+        return policy.actionProbability(action, values);
+    else
+        return policy.PolicyT::actionProbability(action, values);
+}
+
+// Calls the policy's selectWithProbability function, without virtual
+// dispatch when the policy's concrete type is known.
+//
+template <class PolicyT>
+inline Action selectAction(PolicyT& policy, const ActionValues& values, double& _probability) {
+    if constexpr (is_abstract_v<PolicyT>)
+        return policy.selectWithProbability(values, _probability);
+    else
+        return policy.PolicyT::selectWithProbability(values, _probability);
+}
+
+// Gets the action with the greatest value.
+//
+inline Action greedyAction(const ActionValues& values) {
+    // Perform argmax on the given value estimates
+    int best = 0;
+    for (int i=1; i<values.size(); i++) {
+        if (values.value(best)->value() < values.value(i)->value())
+            best = i;
+    }
+    return values.action(best);
+}
+
+// Gets an action from the given view with uniform probability.
+//
+inline Action randomAction(const ActionValues& values) {
+    // Pick a random index
+    return values.action(generator.bounded(values.size()));
+}
+
+// This selection function randomly selects randomly from 
+// the action set with uniform probability.
+//
+inline Action RandomPolicy::select(const ActionValues& values) {
+    return randomAction(values);
+}
+
+// The random policy selects actions with equal probability.
+//
+inline double RandomPolicy::actionProbability(Action, const ActionValues& values) {
+    return 1.0 / values.size();
+}
+
+inline Action RandomPolicy::selectWithProbability(const ActionValues& values, double& _probability) {
+    _probability = 1.0 / values.size();
+    return randomAction(values);
+}
+
+// This selection function selects the action with the greatest
+// value.
+//
+inline Action GreedyPolicy::select(const ActionValues& values) {
+    return greedyAction(values);
+}
+
+// The greedy policy selects the greedy action 100% of the time.
+//
+inline double GreedyPolicy::actionProbability(Action action, const ActionValues& values) {
+    return (action == greedyAction(values));
+}
+
+inline Action GreedyPolicy::selectWithProbability(const ActionValues& values, double& _probability) {
+    _probability = 1;
+    return greedyAction(values);
+}
+
+// This selection function selects...
+//    - the greedy action w/ prob = 1-e
+//    - a random action w/ prob = e
+//
+inline Action EpsilonGreedyPolicy::select(const ActionValues& values) {
+    n_total++;
+    // Generate a random number between 0 and 1
+    double x = generator.uniform();
+    // Follow the greedy action with prob 1-e
+    if (x > m_e) {
+        n_greedy++;
+        return greedyAction(values);
+    } else {
+        return randomAction(values);
+    }
+}
+
+// e-Greedy selects:
+//  - the greedy action w/ probability = (1 - e + e/size)
+//  - the non-greedy action w/ probability = (e/size)
+//  Where 'size' is the size of the valid action set.
+//
+inline double EpsilonGreedyPolicy::actionProbability(Action action, const ActionValues& values) {
+    if (action == greedyAction(values))
+        return (1-m_e+(m_e/values.size()));
+    else
+        return m_e/values.size();
+}
+
+// Selects an action like select. The random action may also be the
+// greedy action, so the greedy action is always looked up.
+//
+inline Action EpsilonGreedyPolicy::selectWithProbability(const ActionValues& values, 
+                                                         double& _probability) {
+    n_total++;
+    Action greedy = greedyAction(values);
+    double x = generator.uniform();
+    Action action;
+    if (x > m_e) {
+        n_greedy++;
+        action = greedy;
+    } else {
+        action = randomAction(values);
+    }
+    if (action == greedy)
+        _probability = 1-m_e+(m_e/values.size());
+    else
+        _probability = m_e/values.size();
+    return action;
+}
+
+// Upper-confidence bound greedy policy.
+// Two factors are used in determining an action:
+// 1) How close a given action is to optimal.
+// 2) Our uncertainty in that estimate.
+//
+inline Action UpperConfidenceBoundPolicy::bestAction(const ActionValues& values) const {
+    // Get the action corresponding to the highest value.
+    Action best_action = values.action(0);
+    double max_value = -DBL_MAX;
+    double value;
+    for (int i=0; i<values.size(); i++) {
+        AvgReturn* rtrn = values.value(i);
+        value = rtrn->value() + m_C*sqrt(log(m_t)/((double)rtrn->samples()+1));
+        if (value > max_value) {
+            max_value = value;
+            best_action = values.action(i);
+        }
+    }
+    return best_action;
+}
+
+// Selects the best action, then advances the time.
+//
+inline Action UpperConfidenceBoundPolicy::select(const ActionValues& values) {
+    if (m_t % 20000 == 0) {
+        for (int i=0; i<values.size(); i++) {
+            AvgReturn* rtrn = values.value(i);
+            cout << "value: " << rtrn->value() << "   adjustment: " <<  m_C*sqrt(log(m_t)/((double)rtrn->samples()+1)) << endl;
+        }
+    }
+    Action best_action = bestAction(values);
+    // Increment the time after each select call.
+    m_t++;
+    // Return the best action.
+    return best_action;
+}
+
+// UCB is a deterministic policy so it selects the best action 100% of the time.
+// The best action is that of the next select call, without making it.
+//
+inline double UpperConfidenceBoundPolicy::actionProbability(Action action, 
+                                                            const ActionValues& values) {
+    return action == bestAction(values);
+}
+
+inline Action UpperConfidenceBoundPolicy::selectWithProbability(const ActionValues& values, 
+                                                                double& _probability) {
+    _probability = 1;
+    return select(values);
+}
@@ -0,0 +1,114 @@
+// This file declares the progress reporting used during training.
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "agent.hpp"
+
+using namespace std;
+
+// Snapshot of a training run's progress.
+struct Progress {
+    // Number of iterations completed so far.
+    unsigned long long iteration;
+    // Total number of iterations in the run.
+    unsigned long long niters;
+    // Seconds spent training so far.
+    double elapsed;
+};
+
+// Base class
+//
+// Observers are called by the learners between iterations, every
+// interval() iterations, starting before the first iteration. The 
+// learners' inner loop runs uninterrupted between reports.
+//
+// After each report, the learners return early if the observer asks
+// them to stop.
+//
+class TrainingObserver {
+    private:
+        unsigned long long m_interval;
+    public:
+        // Constructor
+        // An interval of zero is treated as one.
+        explicit TrainingObserver(unsigned long long interval) : 
+            m_interval(interval > 0 ? interval : 1) {}
+        virtual ~TrainingObserver() {}
+        // Number of iterations between reports.
+        unsigned long long interval() const {return m_interval;}
+        // Reports the progress of the run.
+        // The agent is read-only, reporting must not modify its estimates.
+        virtual void onProgress(const Agent& agent, const Progress& progress) = 0;
+        // Whether training should stop after the last report.
+        virtual bool shouldStop() const {return false;}
+};
+
+// Prints the percentage completed, the training rate and the
+// agent's policy matrix.
+//
+class PolicyMatrixPrinter : public TrainingObserver {
+    public:
+        explicit PolicyMatrixPrinter(unsigned long long interval) : 
+            TrainingObserver(interval) {}
+        void onProgress(const Agent& agent, const Progress& progress);
+};
+
+// Forwards reports to several observers, each at its own interval.
+//
+// The group reports at the shortest of the intervals, and an observer
+// is only called once the run has passed its next multiple of the
+// observer's interval. Every observer is called at the start of a run.
+//
+class ObserverGroup : public TrainingObserver {
+    private:
+        vector<TrainingObserver*> m_observers;
+        // Iteration of the previous report.
+        unsigned long long m_last;
+        // Shortest interval of the observers.
+        static unsigned long long minInterval(const vector<TrainingObserver*>& observers);
+    public:
+        // Constructor
+        // The observers aren't owned by the group.
+        explicit ObserverGroup(const vector<TrainingObserver*>& observers) :
+            TrainingObserver(minInterval(observers)), m_observers(observers), m_last(0) {}
+        void onProgress(const Agent& agent, const Progress& progress);
+        // Stops once any of the observers asks to.
+        bool shouldStop() const;
+};
+
+// Gets the number of iterations to run before the next report.
+// Without an observer, the whole run is a single chunk.
+//
+inline unsigned long long nextReport(TrainingObserver* observer, 
+                                     unsigned long long i, unsigned long long niters) {
+    if (observer == nullptr || niters - i <= observer->interval())
+        return niters;
+    return i + observer->interval();
+}
+
+// Runs the given round function until niters iterations have been
+// trained, reporting to the observer between rounds.
+//
+// round(n) trains the next n iterations. The learners' inner loop runs
+// uninterrupted within a round, and without an observer the whole run
+// is a single round.
+//
+template <typename Round>
+void runRounds(Agent* agent, unsigned long long niters,
+               TrainingObserver* observer, Round round) {
+    auto start = chrono::steady_clock::now();
+    unsigned long long i = 0;
+    while (i < niters) {
+        // Report progress between rounds.
+        if (observer != nullptr) {
+            double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            observer->onProgress(*agent, {i, niters, elapsed});
+            if (observer->shouldStop()) break;
+        }
+        unsigned long long stop = nextReport(observer, i, niters);
+        round(stop - i);
+        i = stop;
+    }
+}
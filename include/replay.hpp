@@ -0,0 +1,68 @@
+// This file declares the replay buffer used to batch episode updates.
+#pragma once
+
+#include <vector>
+
+#include "agent.hpp"
+#include "episode.hpp"
+
+using namespace std;
+
+// Bounded store of completed episodes.
+//
+// The timesteps of every episode are packed back to back in a single
+// flat array, with the end of each hand recorded in a second array.
+// Updates are applied per hand, see Episode.
+// Both are allocated once, so filling and clearing the buffer never
+// allocates, and applying a batch of updates walks memory in order.
+//
+// Generating episodes into the buffer and applying updates from it are
+// separate stages, see generateEpisodes and the batch updates in
+// montecarlo.hpp.
+//
+class ReplayBuffer {
+    private:
+        vector<Timestep> m_steps;
+        // m_ends[i] is one past the last timestep of hand i.
+        vector<int> m_ends;
+        int m_max_episodes;
+        int m_nsteps;
+        int m_nhands;
+        int m_nepisodes;
+    public:
+        // Constructor
+        // Holds up to max_episodes episodes. The timestep capacity
+        // defaults to room for the longest possible final episode on top
+        // of four timesteps per episode, which is several times the
+        // typical episode length.
+        explicit ReplayBuffer(int max_episodes, int max_steps=0);
+        // Appends a copy of the episode. Aborts if the buffer is full.
+        void add(Episode& episode);
+        // Whether another episode is guaranteed to fit.
+        bool full() const {
+            return m_nepisodes == m_max_episodes ||
+                   m_nsteps + MAX_EPISODE_LENGTH > (int) m_steps.size();
+        }
+        // Removes every episode.
+        void clear() {m_nsteps = 0; m_nhands = 0; m_nepisodes = 0;}
+        // Number of episodes, hands and timesteps held.
+        int size() const {return m_nepisodes;}
+        int hands() const {return m_nhands;}
+        int totalSteps() const {return m_nsteps;}
+        // Gets the timesteps of the i-th hand, in order.
+        const Timestep* steps(int i) const {
+            return &m_steps[i == 0 ? 0 : m_ends[i-1]];
+        }
+        int length(int i) const {
+            return m_ends[i] - (i == 0 ? 0 : m_ends[i-1]);
+        }
+};
+
+// Generates up to n episodes into the buffer, stopping early once it
+// is full. Returns the number of episodes generated.
+//
+// The agent's policy can be given as its concrete type so that action
+// selection is inlined into the episode loop.
+template <class PolicyT>
+unsigned long long generateEpisodes(Agent& agent, PolicyT& policy,
+                                    ReplayBuffer& buffer, unsigned long long n);
@@ -1,11 +1,8 @@
 #pragma once
 
-#include <chrono>
-#include <random>
+#include <atomic>
 #include <iostream>
 
-#include "seed.hpp"
-
 using namespace std;
 
 // The possible rewards in the game.
@@ -17,48 +14,111 @@ enum Reward {
 
 // This class is used to store the average return
 // observed for a given state-action pair.
+//
+// The average is kept as the mean itself and the total weight of the
+// returns behind it, and is updated incrementally, so an update never
+// divides by a running total and every way of changing the value leaves
+// the estimate consistent. At 16 bytes, four estimates share a cache line.
+//
 class AvgReturn {
     private:
-        // Store the numerator (n) and denominator (total)
-        // for the average.
-        long long m_total_returns;
-        unsigned long long m_samples;
         double m_value;
+        // Total weight of the averaged returns, the number of returns
+        // for unweighted updates, or the number of constant size steps.
+        double m_weight;
+        // Steps the value towards the target with a compare and swap.
+        double atomicMove(double target, double alpha) {
+            atomic_ref<double> value(m_value);
+            double q = value.load(memory_order_relaxed);
+            while (!value.compare_exchange_weak(q, q + alpha*(target - q), memory_order_relaxed)) {}
+            return q + alpha*(target - q);
+        }
     public:
         // Constructor
         //
-        // Before we have any observations, initialize the value to
-        // a random number in our value range, [-1, 1].
+        // Before we have any observations, the value is only an initial
+        // guess, which is replaced by the first return. See initialValue
+        // in valuetable.hpp.
         //
-        AvgReturn() {
-            // Initialize observations to zeros.
-            m_total_returns = 0; m_samples = 0;
-            // Generate a random number for the initial value estimate
-            uniform_real_distribution<double> distribution(-1, 1);
-            m_value = distribution(generator);
-        }
-        // Setter
+        constexpr explicit AvgReturn(double value=0) : m_value(value), m_weight(0) {}
+        // Setters
         //
-        void update(int sample_return) {
-            m_total_returns += sample_return;
-            m_samples++;
-            m_value = (double) m_total_returns/ m_samples;
+        // Adds a return to the average.
+        void update(double sample_return) {
+            m_weight += 1;
+            m_value += (sample_return - m_value)/m_weight;
+        }
+        // Adds a return with the given weight to the weighted average.
+        void weightedUpdate(double sample_return, double weight) {
+            if (weight == 0) return;
+            m_weight += weight;
+            m_value += (weight/m_weight)*(sample_return - m_value);
         }
+        // Steps the value a fraction alpha of the way towards the target,
+        // for learners with a constant step size, and adds the given
+        // weight, so the weight counts the steps.
+        void step(double target, double alpha, double weight=1) {
+            m_weight += weight;
+            m_value += alpha*(target - m_value);
+        }
+        // Overwrites the value. Later updates continue the average
+        // from the new value, with the same weight.
         void setValue(double value) {
             m_value = value;
         }
+        // Thread-safe updates, for estimates shared between threads.
+        // The weight is incremented atomically and the value is stepped
+        // towards the return with a compare and swap. Concurrent updates
+        // may each step with the weight of the other, so the average is
+        // only approximate under contention.
+        void atomicUpdate(double sample_return) {
+            atomicWeightedUpdate(sample_return, 1);
+        }
+        void atomicWeightedUpdate(double sample_return, double weight) {
+            if (weight == 0) return;
+            double total = atomic_ref<double>(m_weight)
+                .fetch_add(weight, memory_order_relaxed) + weight;
+            atomicMove(sample_return, weight/total);
+        }
+        // Thread-safe step. Returns the new value.
+        double atomicStep(double target, double alpha, double weight=1) {
+            atomic_ref<double>(m_weight).fetch_add(weight, memory_order_relaxed);
+            return atomicMove(target, alpha);
+        }
+        // Restores a previously saved estimate.
+        void restore(double value, double weight) {
+            m_value = value;
+            m_weight = weight;
+        }
+        // Adds returns observed elsewhere (e.g. by a worker thread)
+        // to the average, given as their total and total weight.
+        void merge(double total_returns, double weight) {
+            if (weight == 0) return;
+            m_weight += weight;
+            m_value += (total_returns - weight*m_value)/m_weight;
+        }
         // Getters
         //
-        double value() {
-            return m_value;
+        // The value and weight are loaded atomically, so they can be read
+        // while another thread updates them.
+        double value() const {
+            return atomic_ref<double>(const_cast<double&>(m_value)).load(memory_order_relaxed);
+        }
+        double weight() const {
+            return atomic_ref<double>(const_cast<double&>(m_weight)).load(memory_order_relaxed);
         }
-        long long samples() {
-            return m_samples;
+        long long samples() const {
+            return (long long) weight();
+        }
+        double totalReturns() const {
+            return value()*weight();
         }
         // Print
         //
-        friend ostream& operator<<(ostream& os, AvgReturn& ar) {
-            os << ar.m_value << " = (" << ar.m_total_returns << "/" << ar.m_samples << ")";
+        friend ostream& operator<<(ostream& os, const AvgReturn& ar) {
+            os << ar.m_value << " (weight " << ar.m_weight << ")";
             return os;
         }
-};
\ No newline at end of file
+};
+
+static_assert(sizeof(AvgReturn) == 16);
@@ -0,0 +1,90 @@
+// This file declares the random number generators.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+using namespace std;
+
+// Counter-based generator.
+//
+// The i-th output of a stream is the splitmix64 finalizer applied to
+// key + i*gamma, so each output only depends on the key and its position.
+// Outputs can be generated in any order, the bulk fill has no dependency
+// between iterations and vectorizes, and skipping ahead is free.
+//
+// Different keys give independent streams, see seed(seed, stream).
+//
+// Satisfies the standard uniform random bit generator requirements,
+// so it can be used with std::shuffle and the standard distributions.
+//
+class CounterRng {
+    private:
+        static constexpr uint64_t GAMMA = 0x9E3779B97F4A7C15ull;
+        uint64_t m_key;
+        uint64_t m_counter;
+    public:
+        // Scrambles a 64 bit integer, the splitmix64 finalizer.
+        // Also usable on its own as a hash function.
+        static constexpr uint64_t mix(uint64_t z) {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+        using result_type = uint64_t;
+        static constexpr result_type min() {return 0;}
+        static constexpr result_type max() {return UINT64_MAX;}
+        // Constructor
+        explicit CounterRng(uint64_t seed=0) {this->seed(seed);}
+        // Starts the stream for the given seed from the beginning.
+        void seed(uint64_t seed) {
+            m_key = mix(seed);
+            m_counter = 0;
+        }
+        // Starts one of many independent streams for the same seed,
+        // e.g. one per worker thread.
+        void seed(uint64_t seed, uint64_t stream) {
+            m_key = mix(mix(seed) ^ mix(stream + GAMMA));
+            m_counter = 0;
+        }
+        // Gets the next 64 random bits.
+        uint64_t operator()() {
+            return mix(m_key + GAMMA*(++m_counter));
+        }
+        // Fills the buffer with the next n outputs.
+        void fill(uint64_t* out, size_t n) {
+            for (size_t i=0; i<n; i++)
+                out[i] = mix(m_key + GAMMA*(m_counter + 1 + i));
+            m_counter += n;
+        }
+        // Skips the next n outputs.
+        void discard(unsigned long long n) {m_counter += n;}
+        // Gets an unbiased random integer in [0, range), range > 0.
+        //
+        // Uses Lemire's multiply-shift, which only divides in the rare
+        // case the draw lands in the biased region.
+        uint32_t bounded(uint32_t range) {
+            uint64_t m = (uint64_t) (uint32_t) (*this)() * range;
+            uint32_t low = (uint32_t) m;
+            if (low < range) {
+                uint32_t threshold = -range % range;
+                while (low < threshold) {
+                    m = (uint64_t) (uint32_t) (*this)() * range;
+                    low = (uint32_t) m;
+                }
+            }
+            return m >> 32;
+        }
+        // Gets a random double in [0, 1).
+        double uniform() {
+            return ((*this)() >> 11) * 0x1.0p-53;
+        }
+        // Saves and restores the stream position as text.
+        friend ostream& operator<<(ostream& os, const CounterRng& rng) {
+            return os << rng.m_key << " " << rng.m_counter;
+        }
+        friend istream& operator>>(istream& is, CounterRng& rng) {
+            return is >> rng.m_key >> rng.m_counter;
+        }
+};
@@ -1,10 +1,20 @@
 #pragma once
 
 #include <chrono>
-#include <random>
+#include <cstdint>
+
+#include "rng.hpp"
 
 using namespace std;
 
+// The generator used throughout the program. Any generator with the
+// same interface as CounterRng can be plugged in here.
+using Rng = CounterRng;
+
 // Initialize seed and generator for the program.
-inline unsigned seed = chrono::system_clock::now().time_since_epoch().count();
-inline default_random_engine generator(seed);
\ No newline at end of file
+//
+// Each thread owns its own generator so that worker threads
+// draw from independent streams. Threads other than the main
+// thread should reseed their generator before using it.
+inline uint64_t seed = chrono::system_clock::now().time_since_epoch().count();
+inline thread_local Rng generator(seed);
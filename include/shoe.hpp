@@ -0,0 +1,46 @@
+// This file declares the finite shoe the cards are dealt from.
+#pragma once
+
+using namespace std;
+
+// Bounds on the number of decks in a shoe.
+const int MIN_DECKS = 1;
+const int MAX_DECKS = 8;
+const int CARDS_PER_DECK = 52;
+
+// A shoe of one or more shuffled decks.
+//
+// Cards are dealt in order from a cursor. Once the cursor passes the
+// cut card the shoe is reshuffled before the next hand. The cut card
+// is placed at the given penetration, the fraction of the shoe dealt
+// before reshuffling.
+//
+class Shoe {
+    private:
+        // Card values, aces are stored as 11.
+        int m_cards[MAX_DECKS*CARDS_PER_DECK];
+        int m_size;   // number of cards in the shoe
+        int m_cursor; // position of the next card to be dealt
+        int m_cut;    // position of the cut card
+    public:
+        // Constructor
+        Shoe(int ndecks, double penetration);
+        // Shuffles every card back into the shoe.
+        void shuffle();
+        // Deals the next card from the shoe.
+        // The shoe is reshuffled if it runs out mid-hand.
+        int deal() {
+            if (m_cursor == m_size)
+                shuffle();
+            return m_cards[m_cursor++];
+        }
+        // Reshuffles the shoe if the cut card has been reached.
+        // Called before each new hand.
+        void newHand() {
+            if (m_cursor >= m_cut)
+                shuffle();
+        }
+        // Getters
+        int decks() const {return m_size/CARDS_PER_DECK;}
+        int remaining() const {return m_size - m_cursor;}
+};
@@ -0,0 +1,47 @@
+// This file declares the bounded queue used to pass work between threads.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+// Bounded, lock-free queue for exactly one producer thread and one
+// consumer thread.
+//
+// The producer only writes the head and the consumer only writes the
+// tail. Both only ever increase, the slot is the index modulo the
+// capacity. They are kept on separate cache lines so the two threads
+// don't contend for the same line.
+//
+// Capacity must be a power of two.
+//
+template <class T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity-1)) == 0, "Capacity must be a power of two");
+    private:
+        T m_items[Capacity];
+        alignas(64) atomic<size_t> m_head{0};
+        alignas(64) atomic<size_t> m_tail{0};
+    public:
+        // Adds an item. Returns false if the queue is full.
+        // Only called by the producer.
+        bool push(const T& item) {
+            size_t head = m_head.load(memory_order_relaxed);
+            if (head - m_tail.load(memory_order_acquire) == Capacity)
+                return false;
+            m_items[head % Capacity] = item;
+            m_head.store(head+1, memory_order_release);
+            return true;
+        }
+        // Removes the oldest item. Returns false if the queue is empty.
+        // Only called by the consumer.
+        bool pop(T& item) {
+            size_t tail = m_tail.load(memory_order_relaxed);
+            if (tail == m_head.load(memory_order_acquire))
+                return false;
+            item = m_items[tail % Capacity];
+            m_tail.store(tail+1, memory_order_release);
+            return true;
+        }
+};
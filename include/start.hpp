@@ -0,0 +1,78 @@
+// This file declares the distributions of the episodes' starting states.
+#pragma once
+
+#include "seed.hpp"
+#include "state.hpp"
+
+using namespace std;
+
+// Ways the environment can choose the starting state of an episode.
+//    * FixedStart      - always a hard 17 against an 8.
+//    * DealtStart      - deal two cards to the player and an up card to
+//                        the dealer.
+//    * ExploringStart  - every starting state with equal probability.
+//    * StratifiedStart - visit every starting state once per pass, in an
+//                        order reshuffled for each pass, so that no state
+//                        is under-sampled.
+//
+// The starting states are every two card hand and up card, in the
+// Opening or Pair phase. Dealt blackjacks are never starting states,
+// since the player has no decision to make.
+//
+enum StartMode {
+    FixedStart,
+    DealtStart,
+    ExploringStart,
+    StratifiedStart
+};
+
+// 33 two card hands other than blackjack against 10 up cards.
+const int NUM_START_STATES = 330;
+
+// Each card is one of 13 equally likely ranks with an infinite deck.
+// The player can be dealt 13*13 ordered pairs of ranks, 8 of which are
+// an ace and a ten valued card, against 13 up cards.
+const int NUM_DEALS = (13*13 - 8) * 13;
+
+// Every starting state, with the probability of it being dealt from an
+// infinite deck given that the player wasn't dealt a blackjack.
+//
+// Every deal of ranks other than a blackjack is equally likely, so dealt
+// starting states are drawn with a single random index into the table
+// of deals, instead of dealing cards until the hand isn't a blackjack.
+//
+class StartDistribution {
+    private:
+        State m_states[NUM_START_STATES];
+        double m_probs[NUM_START_STATES];
+        // Starting state of every deal.
+        State m_deals[NUM_DEALS];
+    public:
+        // Enumerates the deals and the starting states.
+        StartDistribution();
+        // Gets the i-th starting state and its probability of being dealt.
+        const State& state(int i) const {return m_states[i];}
+        double probability(int i) const {return m_probs[i];}
+        // Draws a dealt starting state.
+        const State& sample() const {return m_deals[generator.bounded(NUM_DEALS)];}
+};
+
+// Table computed once at startup.
+extern const StartDistribution start_distribution;
+
+// Shuffled passes over the starting states, for stratified starts.
+//
+class StartStrata {
+    private:
+        int m_order[NUM_START_STATES];
+        int m_cursor;
+    public:
+        // Constructor
+        // The first pass is shuffled on first use.
+        StartStrata() : m_cursor(NUM_START_STATES) {
+            for (int i=0; i<NUM_START_STATES; i++)
+                m_order[i] = i;
+        }
+        // Gets the next starting state of the current pass.
+        const State& next();
+};
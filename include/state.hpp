@@ -1,62 +1,152 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 
 #include "action.hpp"
 
 using namespace std;
 
+// The point of the hand at which the player is acting, which determines
+// the valid actions:
+//    * Drawn     - after hitting, the player can only hit or stay.
+//    * SplitHand - first action of a hand made by splitting a pair,
+//                  the player can also double.
+//    * Opening   - first action of a dealt hand, the player can also
+//                  double or surrender.
+//    * Pair      - first action of a dealt pair, the player can also split.
+//
+// Each phase allows one more action than the last, in the order of the
+// Action enum.
+enum Phase {
+    Drawn,
+    SplitHand,
+    Opening,
+    Pair
+};
+const int NUM_PHASES = 4;
+
+// Bounds of the states with value estimates.
+//    * count  - player counts [4, 21]
+//    * dealer - dealer face up card [2, 11]
+//    * hard   - hard or soft count
+//    * phase  - every phase
+const int MIN_COUNT = 4;
+const int MAX_COUNT = 21;
+const int MIN_DEALER = 2;
+const int MAX_DEALER = 11;
+const int NUM_STATES = (MAX_COUNT-MIN_COUNT+1) * (MAX_DEALER-MIN_DEALER+1) * 2 * NUM_PHASES;
+
 class State {
     private:
-        // States are uniquely defined by the triplet:
+        // States are uniquely defined by the tuple:
         //    * count  - sum of cards in the player's hand
         //    * dealer - the card the dealer has face up
         //    * hard   - whether or not the player is holding a usable ace.
+        //    * phase  - the point of the hand, see Phase.
         //
-        // Note - m_usable_aces is helpful for handling state transitions,
-        //        but is not considered as part of the state for the monte
-        //        carlo algorithm.
-        int m_count;
-        int m_dealer;
-        int m_usable_aces;
+        // Note - the number of usable aces is helpful for handling state
+        //        transitions, but is not considered as part of the state
+        //        for the monte carlo algorithm.
+        //
+        // The fields are packed into 16 bits:
+        //    * bits 0-5   - count, up to 63 so busted counts fit.
+        //    * bits 6-9   - dealer
+        //    * bits 10-12 - usable aces
+        //    * bits 13-14 - phase
+        static constexpr int COUNT_SHIFT = 0;
+        static constexpr int DEALER_SHIFT = 6;
+        static constexpr int ACES_SHIFT = 10;
+        static constexpr int PHASE_SHIFT = 13;
+        static constexpr uint16_t COUNT_MASK = 0x3f << COUNT_SHIFT;
+        static constexpr uint16_t DEALER_MASK = 0xf << DEALER_SHIFT;
+        static constexpr uint16_t ACES_MASK = 0x7 << ACES_SHIFT;
+        static constexpr uint16_t PHASE_MASK = 0x3 << PHASE_SHIFT;
+        uint16_t m_bits;
+        // Packs the fields into their bits.
+        static constexpr uint16_t encode(int count, int dealer, int usable_aces, Phase phase) {
+            return (uint16_t) ((count << COUNT_SHIFT) |
+                               (dealer << DEALER_SHIFT) |
+                               (usable_aces << ACES_SHIFT) |
+                               (phase << PHASE_SHIFT));
+        }
+        // Replaces the bits of a single field.
+        constexpr void setField(uint16_t mask, int shift, int value) {
+            m_bits = (uint16_t) ((m_bits & ~mask) | ((value << shift) & mask));
+        }
     public:
         // Constructors
-        explicit State() :
-            m_count(0),
-            m_dealer(0),
-            m_usable_aces(0) {}
-        explicit State(int count, int dealer, int usable_aces) : 
-            m_count(count), 
-            m_dealer(dealer), 
-            m_usable_aces(usable_aces) {}
-        explicit State(const State* s) :
-            m_count(s->count()),
-            m_dealer(s->dealer()),
-            m_usable_aces(s->usableAces()) {}
+        constexpr explicit State() : m_bits(0) {}
+        constexpr explicit State(int count, int dealer, int usable_aces, Phase phase=Drawn) :
+            m_bits(encode(count, dealer, usable_aces, phase)) {}
+        constexpr explicit State(const State* s) : m_bits(s->m_bits) {}
+        // Recovers the state with the given index, see index().
+        // Soft states are given a single usable ace.
+        static constexpr State fromIndex(int idx) {
+            Phase phase = (Phase) (idx % NUM_PHASES);
+            idx /= NUM_PHASES;
+            int soft = idx % 2;
+            idx /= 2;
+            int dealer = idx % (MAX_DEALER-MIN_DEALER+1) + MIN_DEALER;
+            idx /= (MAX_DEALER-MIN_DEALER+1);
+            return State(idx + MIN_COUNT, dealer, soft, phase);
+        }
         // Getters
-        int count() const {return m_count;}
-        int dealer() const {return m_dealer;}
-        bool hard() const {return m_usable_aces == 0;}
-        int usableAces() const {return m_usable_aces;}
+        constexpr int count() const {return (m_bits & COUNT_MASK) >> COUNT_SHIFT;}
+        constexpr int dealer() const {return (m_bits & DEALER_MASK) >> DEALER_SHIFT;}
+        constexpr bool hard() const {return (m_bits & ACES_MASK) == 0;}
+        constexpr int usableAces() const {return (m_bits & ACES_MASK) >> ACES_SHIFT;}
+        constexpr Phase phase() const {return (Phase) ((m_bits & PHASE_MASK) >> PHASE_SHIFT);}
+        // Number of valid actions in the state. The valid actions are
+        // the first numActions() actions of the Action enum.
+        constexpr int numActions() const {return phase() + 2;}
+        // Packs the fields that define the state into an integer with the
+        // same order as the states, [count][dealer][soft][phase].
+        constexpr int key() const {
+            return (((count() << 4) | dealer()) << 1 | !hard()) << 2 | phase();
+        }
+        // Perfect index of the states within the table bounds,
+        // in [0, NUM_STATES) with the layout [count][dealer][soft][phase].
+        // States outside of the bounds have no index, see inBounds().
+        constexpr int index() const {
+            int idx = count() - MIN_COUNT;
+            idx = idx*(MAX_DEALER-MIN_DEALER+1) + (dealer() - MIN_DEALER);
+            idx = idx*2 + !hard();
+            return idx*NUM_PHASES + phase();
+        }
+        constexpr bool inBounds() const {
+            return count() >= MIN_COUNT && count() <= MAX_COUNT &&
+                   dealer() >= MIN_DEALER && dealer() <= MAX_DEALER;
+        }
         // Setters
-        void setCount(int count) {m_count = count;}
-        void setDealer(int dealer) {m_dealer = dealer;}
-        void setUsableAces(int usable_aces) {m_usable_aces = usable_aces;}
-        void incUsableAces() {m_usable_aces++;}
-        void decUsableAces() {m_usable_aces--;}
+        constexpr void setCount(int count) {setField(COUNT_MASK, COUNT_SHIFT, count);}
+        constexpr void setDealer(int dealer) {setField(DEALER_MASK, DEALER_SHIFT, dealer);}
+        constexpr void setUsableAces(int usable_aces) {setField(ACES_MASK, ACES_SHIFT, usable_aces);}
+        constexpr void setPhase(Phase phase) {setField(PHASE_MASK, PHASE_SHIFT, phase);}
+        constexpr void incUsableAces() {m_bits += 1 << ACES_SHIFT;}
+        constexpr void decUsableAces() {m_bits -= 1 << ACES_SHIFT;}
         // Operators
-        bool operator<(const State& s) const;
-        bool operator==(const State& s) const;
+        // Note - states are defined by player count, dealer card, phase,
+        //        and whether or not the player count is hard.
+        //        This means two states with different usable ace counts
+        //        are considered to be equivalent.
+        constexpr bool operator<(const State& s) const {return key() < s.key();}
+        constexpr bool operator==(const State& s) const {return key() == s.key();}
         friend ostream& operator<<(ostream& os, const State& s);
 };
 
+// The index is a bijection between the states in bounds and [0, NUM_STATES).
+static_assert(State::fromIndex(0).index() == 0);
+static_assert(State::fromIndex(NUM_STATES-1).index() == NUM_STATES-1);
+static_assert(State(MAX_COUNT, MAX_DEALER, 1, Pair).index() == NUM_STATES-1);
+static_assert(State(0, 0, 0, Pair).numActions() == NUM_ACTIONS);
+static_assert(sizeof(State) == 2);
+
 // Hash function for state-action pairs.
+// The state's key and the action are packed together, leaving room for
+// eight actions, so distinct pairs never collide.
 struct SAHashFunction {
     size_t operator()(const pair<State, Action>& sa_pair) const {
-        size_t count_hash = std::hash<int>()(sa_pair.first.count());
-        size_t dealer_hash = std::hash<int>()(sa_pair.first.dealer());
-        size_t ace_hash = std::hash<int>()(sa_pair.first.hard());
-        size_t act_hash = std::hash<int>()(sa_pair.second);
-        return count_hash ^ dealer_hash ^ ace_hash ^ act_hash;
+        return (size_t) sa_pair.first.key() << 3 | sa_pair.second;
     }
-};
\ No newline at end of file
+};
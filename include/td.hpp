@@ -0,0 +1,42 @@
+// This file declares the temporal difference learners.
+#pragma once
+
+#include "agent.hpp"
+#include "progress.hpp"
+
+using namespace std;
+
+// The target each step's estimate is moved towards, on top of the
+// step's reward:
+//    - Sarsa: the value of the action the policy takes next.
+//    - ExpectedSarsa: the expected value of the next action under the policy.
+//    - QLearning: the value of the greedy next action.
+enum TDMethod {Sarsa, ExpectedSarsa, QLearning};
+
+// Default step size of the temporal difference learners.
+const double DEFAULT_ALPHA = 0.01;
+
+// This function performs online temporal difference control.
+//
+// Unlike the monte carlo learners, the estimates are updated after
+// every step of an episode, with a constant step size alpha, so no
+// episode is buffered.
+//
+// With lambda > 0, the update is TD(lambda): each step's error also
+// moves the estimates of the hand's earlier steps, in proportion to
+// their eligibility traces, which decay by gamma*lambda every step.
+// The traces are replacing, and with QLearning they are cut after a
+// non-greedy action (Watkins's Q(lambda)).
+//
+// A split is the last step of the pair's hand, and the split hands are
+// each learned from online as hands of their own. Sarsa's target for
+// the split is the split hands' total reward. Expected Sarsa and
+// Q-learning bootstrap from each split hand's starting state, with the
+// expected and the greedy value of its actions, so they learn the
+// split's value under their own target policy.
+//
+// Like the other learners, it is templated on the type of the agent's policy.
+template <class PolicyT = Policy>
+void tdLearner(Agent* agent, unsigned long long niters, TDMethod method,
+               double alpha=DEFAULT_ALPHA, double lambda=0, double gamma=1,
+               TrainingObserver* observer=nullptr);
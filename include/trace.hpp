@@ -0,0 +1,99 @@
+// This file declares the structured tracing of training runs.
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "action.hpp"
+#include "state.hpp"
+
+using namespace std;
+
+// Tracing is compiled in up to TRACE_LEVEL, set at build time with
+// `make TRACE=N`. At the default level of zero every TRACE statement
+// compiles away, arguments included.
+//
+//    1 - episode starts, timesteps and value iteration sweeps.
+//    2 - value estimate updates.
+//    3 - cards dealt to the player and the dealer.
+//
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 0
+#endif
+
+const int TRACE_EPISODES = 1;
+const int TRACE_UPDATES = 2;
+const int TRACE_CARDS = 3;
+
+#if TRACE_LEVEL > 0
+#define TRACE(level, call) do { if constexpr ((level) <= TRACE_LEVEL) { call; } } while (0)
+#else
+#define TRACE(level, call) do {} while (0)
+#endif
+
+enum TraceEvent : uint8_t {
+    TraceEpisode,
+    TraceStep,
+    TraceUpdate,
+    TracePlayerCard,
+    TraceDealerCard,
+    TraceDealerFinal,
+    TraceSweep
+};
+
+// Trace file layout, version 1.
+//
+// A fixed-size header followed by fixed-size records in the order
+// each thread emitted them. Records of different threads interleave.
+//
+const char TRACE_MAGIC[8] = {'R', 'L', 'B', 'J', 'T', 'R', 'C', 'E'};
+const uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+// Fields that don't apply to an event are zero.
+struct TraceRecord {
+    // Per-thread episode number, or the sweep number for TraceSweep.
+    uint64_t episode;
+    // Order in which the emitting thread first traced.
+    uint16_t thread;
+    uint8_t event;
+    uint8_t action;
+    // Player state. TraceDealerFinal holds the player's final count
+    // in count and the dealer's in dealer.
+    uint8_t count;
+    uint8_t dealer;
+    uint8_t soft;
+    uint8_t card;
+    // Reward for TraceStep and TraceDealerFinal, return for TraceUpdate,
+    // delta for TraceSweep.
+    float reward;
+    // Value estimate after a TraceUpdate.
+    float value;
+};
+
+// Starts writing the trace records of every thread to the given path.
+// Records are buffered in a ring per thread and written by a background
+// thread. Returns false if the file couldn't be opened.
+bool traceOpen(const string& path);
+
+// Writes the remaining records and closes the trace.
+// Every other tracing thread must have finished.
+void traceClose();
+
+// Emitters, called through the TRACE macro.
+// Each thread's episode number is incremented by traceEpisode.
+void traceEpisode();
+void traceStep(const State& state, Action action, double reward);
+void traceUpdate(const State& state, Action action, double rtrn, double value);
+void traceCard(int card, bool dealer);
+void traceDealerFinal(int player_count, int dealer_count, double reward);
+void traceSweep(int sweep, double delta);
+
+// Prints the records of a trace file as text.
+bool dumpTrace(const string& path, ostream& os);
@@ -0,0 +1,213 @@
+// This file declares the stores used to hold state-action value estimates.
+#pragma once
+
+#include <map>
+#include <utility>
+
+#include "action.hpp"
+#include "reward.hpp"
+#include "state.hpp"
+
+using namespace std;
+
+// The dense value table covers every valid state-action pair of the
+// states within the bounds in state.hpp.
+//
+// States which only differ in their phase share a block of the table,
+// holding the valid actions of each phase one after the other. Phase p
+// has p+2 valid actions, which start at phaseOffset(p) in the block.
+constexpr int phaseOffset(int phase) {return phase*(phase+3)/2;}
+const int BLOCK_SIZE = phaseOffset(NUM_PHASES);
+const int NUM_STATE_ACTIONS = NUM_STATES/NUM_PHASES * BLOCK_SIZE;
+static_assert(phaseOffset(NUM_PHASES-1) + NUM_ACTIONS == BLOCK_SIZE);
+
+// How new value estimates are initialized.
+//    * HashedInit   - a value in [-1, 1] hashed from the seed and the
+//                     state-action pair. Like a random initialization,
+//                     ties between unexplored actions are broken
+//                     arbitrarily, but every table and thread agrees.
+//    * ConstantInit - the same value for every pair.
+//
+enum ValueInit {
+    HashedInit,
+    ConstantInit
+};
+
+// Configures how new value estimates are initialized.
+// Must be called before any value tables are created.
+void useValueInit(ValueInit init, double value=0);
+
+// Gets the initial value estimate for the state-action pair.
+double initialValue(const State& state, const Action action);
+
+// Non-owning, fixed-size view of the value estimates for the
+// actions available in a state.
+//
+// Views are small enough to be built on the stack for every
+// action selection, so selecting an action never allocates.
+//
+class ActionValues {
+    private:
+        Action m_actions[NUM_ACTIONS];
+        AvgReturn* m_values[NUM_ACTIONS];
+        int m_size;
+    public:
+        // Constructor
+        ActionValues() : m_size(0) {}
+        // Adds the value estimate for an action to the view.
+        void add(Action action, AvgReturn* value) {
+            m_actions[m_size] = action;
+            m_values[m_size] = value;
+            m_size++;
+        }
+        // Getters
+        int size() const {return m_size;}
+        Action action(int i) const {return m_actions[i];}
+        AvgReturn* value(int i) const {return m_values[i];}
+};
+
+// Base class
+//
+class ValueTable {
+    public:
+        virtual ~ValueTable() {}
+        // Gets the value estimate for the given state-action pair.
+        // Estimates that haven't been seen before are initialized
+        // with initialValue.
+        virtual AvgReturn* get(const State& state, const Action action) = 0;
+        // Gets the value estimate for the given state-action pair without
+        // creating it. Returns null if the pair hasn't been seen before.
+        virtual const AvgReturn* peek(const State& state, const Action action) const = 0;
+        // Adds a return to the average for the given state-action pair.
+        // Returns the updated value.
+        virtual double update(const State& state, const Action action, double rtrn) {
+            AvgReturn* value = get(state, action);
+            value->update(rtrn);
+            return value->value();
+        }
+        // Adds a return with the given weight to the weighted average for
+        // the given state-action pair. Returns the updated value.
+        virtual double weightedUpdate(const State& state, const Action action, 
+                                      double rtrn, double weight) {
+            AvgReturn* value = get(state, action);
+            value->weightedUpdate(rtrn, weight);
+            return value->value();
+        }
+        // Steps the value for the given state-action pair towards the
+        // target by alpha, adding weight to its weight. Returns the
+        // updated value.
+        virtual double step(const State& state, const Action action,
+                            double target, double alpha, double weight) {
+            AvgReturn* value = get(state, action);
+            value->step(target, alpha, weight);
+            return value->value();
+        }
+        // Whether update, weightedUpdate and step can be called by many
+        // threads at once.
+        virtual bool concurrent() const {return false;}
+        // Gets a view of the value estimates for every action in the given state.
+        virtual ActionValues getActions(const State& state) {
+            ActionValues values;
+            for (int a=0; a<state.numActions(); a++)
+                values.add((Action) a, get(state, (Action) a));
+            return values;
+        }
+        // Returns a heap allocated deep copy of the table.
+        virtual ValueTable* clone() const = 0;
+};
+
+// Flat, contiguous table indexed directly by the packed
+// state-action index. Every estimate is allocated up front,
+// so lookups never allocate or search.
+//
+class DenseValueTable : public ValueTable {
+    protected:
+        AvgReturn m_entries[NUM_STATE_ACTIONS];
+    public:
+        // Every estimate is initialized up front.
+        DenseValueTable();
+        // Maps a state-action pair onto its position in the table.
+        // The layout is [count][dealer][soft][phase][action], where each
+        // phase only holds its valid actions.
+        static int index(const State& state, const Action action) {
+            if (!state.inBounds() || action >= state.numActions()) 
+                invalidPair(state, action);
+            return (state.index()/NUM_PHASES)*BLOCK_SIZE + phaseOffset(state.phase()) + action;
+        }
+        // Aborts on a state outside of the table bounds, or an action
+        // which isn't valid in the state.
+        [[noreturn]] static void invalidPair(const State& state, const Action action);
+        // Recovers the state-action pair stored at the given index.
+        static void decode(int idx, State& state, Action& action);
+        AvgReturn* get(const State& state, const Action action) {
+            return &m_entries[index(state, action)];
+        }
+        const AvgReturn* peek(const State& state, const Action action) const {
+            return &m_entries[index(state, action)];
+        }
+        // A state's estimates are contiguous, so the view is built from
+        // a single index computation.
+        ActionValues getActions(const State& state) {
+            ActionValues values;
+            AvgReturn* first = &m_entries[index(state, (Action) 0)];
+            for (int a=0; a<state.numActions(); a++)
+                values.add((Action) a, first + a);
+            return values;
+        }
+        ValueTable* clone() const { return new DenseValueTable(*this); }
+};
+
+// Dense table that many threads can update at once without locks,
+// for Hogwild-style training where every worker updates one table.
+//
+// Updates are atomic per estimate and reads are wait-free relaxed loads,
+// so a reader may see an estimate that lags a concurrent update.
+// Only updates are thread-safe, estimates must not be created, restored 
+// or cloned while other threads are updating the table.
+//
+class SharedValueTable : public DenseValueTable {
+    public:
+        SharedValueTable() {}
+        double update(const State& state, const Action action, double rtrn) {
+            AvgReturn* value = get(state, action);
+            value->atomicUpdate(rtrn);
+            return value->value();
+        }
+        double weightedUpdate(const State& state, const Action action, 
+                              double rtrn, double weight) {
+            AvgReturn* value = get(state, action);
+            value->atomicWeightedUpdate(rtrn, weight);
+            return value->value();
+        }
+        double step(const State& state, const Action action,
+                    double target, double alpha, double weight) {
+            return get(state, action)->atomicStep(target, alpha, weight);
+        }
+        bool concurrent() const {return true;}
+        ValueTable* clone() const { return new SharedValueTable(*this); }
+};
+
+// Ordered map from state-action pairs to value estimates.
+// Estimates are allocated the first time they are looked up.
+//
+class MapValueTable : public ValueTable {
+    private:
+        map<pair<State, Action>, AvgReturn*>* m_values;
+    public:
+        MapValueTable() : m_values(new map<pair<State, Action>, AvgReturn*>) {}
+        // Takes ownership of the given map.
+        explicit MapValueTable(map<pair<State, Action>, AvgReturn*>* values) : m_values(values) {}
+        ~MapValueTable() {
+            // Deallocate the value estimates.
+            for (auto item : *m_values)
+                delete(item.second);
+            // Deallocate the value map
+            delete(m_values);
+        }
+        AvgReturn* get(const State& state, const Action action);
+        const AvgReturn* peek(const State& state, const Action action) const {
+            auto it = m_values->find({state, action});
+            return (it == m_values->end()) ? nullptr : it->second;
+        }
+        ValueTable* clone() const;
+};
@@ -1,3 +0,0 @@
-#pragma once
-
-#define VERBOSE 0
\ No newline at end of file
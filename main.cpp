@@ -1,17 +1,78 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <vector>
 
 #include "agent.hpp"
+#include "checkpoint.hpp"
+#include "convergence.hpp"
+#include "dp.hpp"
 #include "montecarlo.hpp"
+#include "parallel.hpp"
+#include "pipeline.hpp"
+#include "progress.hpp"
+#include "td.hpp"
 
 #include "environment.hpp"
 #include "episode.hpp"
+#include "seed.hpp"
+#include "shoe.hpp"
 #include "state.hpp"
-#include "verbose.hpp"
+#include "trace.hpp"
 
 using namespace std;
 
+// How the agent is trained, set from the command line.
+struct TrainOptions {
+    bool isOnPolicy;
+    // Whether a temporal difference learner is used instead of monte carlo.
+    bool td;
+    TDMethod method;
+    double alpha;
+    double lambda;
+    unsigned nthreads;
+    // Episodes per replay batch, or zero to update after every episode.
+    int batch;
+    // Whether generator threads feed a single updater.
+    bool pipeline;
+    unsigned long long publish_every;
+};
+
+// Trains the agent with the type of its policy known at compile time,
+// so that action selection is inlined into the training loop.
+//
+// Threads share the agent's estimates if its value table is concurrent.
+//
+template <class PolicyT>
+void train(Agent* agent, const TrainOptions& options, unsigned long long niters,
+           TrainingObserver* observer) {
+    bool isOnPolicy = options.isOnPolicy;
+    unsigned nthreads = options.nthreads;
+    if (options.td) {
+        tdLearner<PolicyT>(agent, niters, options.method, options.alpha, options.lambda, 
+                           1, observer);
+    } else if (options.pipeline) {
+        isOnPolicy ? pipelinedOnPolicyLearner<PolicyT>(agent, niters, nthreads, options.batch, 
+                                                       1, options.publish_every, observer) 
+                   : pipelinedOffPolicyLearner<PolicyT>(agent, niters, nthreads, options.batch, 
+                                                        1, options.publish_every, observer);
+    } else if (options.batch > 0) {
+        isOnPolicy ? onPolicyBatchLearner<PolicyT>(agent, niters, options.batch, 1, observer) 
+                   : offPolicyBatchLearner<PolicyT>(agent, niters, options.batch, 1, observer);
+    } else if (nthreads > 1 && agent->values().concurrent()) {
+        isOnPolicy ? hogwildOnPolicyLearner<PolicyT>(agent, niters, nthreads, 1, observer) 
+                   : hogwildOffPolicyLearner<PolicyT>(agent, niters, nthreads, 1, observer);
+    } else if (nthreads > 1) {
+        isOnPolicy ? parallelOnPolicyLearner<PolicyT>(agent, niters, nthreads, 1, observer) 
+                   : parallelOffPolicyLearner<PolicyT>(agent, niters, nthreads, 1, observer);
+    } else {
+        isOnPolicy ? onPolicyLearner<PolicyT>(agent, niters, 1, observer) 
+                   : offPolicyLearner<PolicyT>(agent, niters, 1, observer);
+    }
+}
+
 int main(int argc, char* argv[]) {
     
     cout << endl;
@@ -19,56 +80,365 @@ int main(int argc, char* argv[]) {
     // Use index to iterate through the cli args.
     int i = 1;
 
-    // Parse whether we are using on or off policy MC.
-    if (i > argc) return EXIT_FAILURE;
-    if (strcmp(argv[i], "on") && strcmp(argv[i], "off")) return EXIT_FAILURE;
-    bool isOnPolicy = (strcmp(argv[i], "on") == 0);
-    cout << (isOnPolicy ? "On-Policy" : "Off-Policy") << endl;
+    // Solve for the exact optimal policy with dynamic programming.
+    // The solution is saved as a checkpoint if a path is given, so that
+    // it can be used as a -reference.
+    if (i < argc && strcmp(argv[i], "dp") == 0) {
+        cout << "Value Iteration" << endl;
+        GreedyPolicy greedy;
+        Agent solution(greedy);
+        int sweeps = valueIterationSolver(&solution);
+        cout << "Converged after " << sweeps << " sweeps" << endl;
+        cout << endl;
+        solution.printPolicyMatrix();
+        if (i+1 < argc && !saveCheckpoint(solution, 0, argv[i+1])) return EXIT_FAILURE;
+        return 0;
+    }
+
+    // Print a trace file written with -trace.
+    if (i+1 < argc && strcmp(argv[i], "trace") == 0) {
+        return dumpTrace(argv[i+1], cout) ? 0 : EXIT_FAILURE;
+    }
+
+    // Parse whether we are using on or off policy MC, or a TD method.
+    if (i >= argc) return EXIT_FAILURE;
+    bool isOnPolicy = true;
+    bool td = true;
+    TDMethod method = Sarsa;
+    if (strcmp(argv[i], "on") == 0) {
+        td = false;
+        cout << "On-Policy" << endl;
+    } else if (strcmp(argv[i], "off") == 0) {
+        td = false;
+        isOnPolicy = false;
+        cout << "Off-Policy" << endl;
+    } else if (strcmp(argv[i], "sarsa") == 0) {
+        method = Sarsa;
+        cout << "Sarsa" << endl;
+    } else if (strcmp(argv[i], "expected") == 0) {
+        method = ExpectedSarsa;
+        cout << "Expected Sarsa" << endl;
+    } else if (strcmp(argv[i], "qlearning") == 0) {
+        method = QLearning;
+        cout << "Q-Learning" << endl;
+    } else {
+        cerr << "Unrecognized learner!" << endl;
+        return EXIT_FAILURE;
+    }
     i++;
 
     // Parse policy and create the agent.
-    if (i > argc) return EXIT_FAILURE;
+    if (i >= argc) return EXIT_FAILURE;
     Policy* policy = NULL;
+    void (*trainer)(Agent*, const TrainOptions&, unsigned long long, TrainingObserver*) = NULL;
     if (strcmp(argv[i], "random") == 0) {
         cout << "Random Policy" << endl;
         policy = new RandomPolicy;
+        trainer = train<RandomPolicy>;
     } else if (strcmp(argv[i], "greedy") == 0) {
         cout << "Greedy Policy" << endl;
         policy = new GreedyPolicy;
+        trainer = train<GreedyPolicy>;
     } else if (strcmp(argv[i], "egreedy") == 0) {
         i++;
         cout << "Epsilon Policy" << endl;
+        if (i >= argc) return EXIT_FAILURE;
         cout << "e = " << argv[i] << endl;
-        if (i > argc) return EXIT_FAILURE;
         policy = new EpsilonGreedyPolicy(atof(argv[i]));
+        trainer = train<EpsilonGreedyPolicy>;
     } else if (strcmp(argv[i], "ucb") == 0) {
         i++;
         cout << "Upper-Confidence Bound Policy" << endl;
+        if (i >= argc) return EXIT_FAILURE;
         cout << "C = " << argv[i] << endl;
-        if (i > argc) return EXIT_FAILURE;
         policy = new UpperConfidenceBoundPolicy(atof(argv[i]));
+        trainer = train<UpperConfidenceBoundPolicy>;
     } else {
         cerr << "Unrecognized policy!" << endl;
         return EXIT_FAILURE;
     }
-    Agent* agent = new Agent(*policy);
     i++;
 
     // Parse number of policy iterations
-    if(i > argc) return EXIT_FAILURE;
+    if (i >= argc) return EXIT_FAILURE;
     unsigned long long niters = stoull(argv[i]);
     cout << "Iterations = " << argv[i] << endl;
+    i++;
+
+    // Parse optional arguments.
+    //    -threads N : number of worker threads generating episodes.
+    //    -hogwild   : worker threads update one shared table without locks.
+    //    -batch N   : generate N episodes into a replay buffer between updates.
+    //    -pipeline  : -threads generator threads feed episodes to one updater.
+    //    -publish-every N : episodes between pipeline snapshots.
+    //    -alpha A   : step size of the TD learners.
+    //    -lambda L  : trace decay of the TD learners, 0 for one-step updates.
+    //    -seed S    : seed for the random number generators.
+    //    -decks N   : deal from a shoe of N decks instead of an infinite deck.
+    //    -penetration P : fraction of the shoe dealt before reshuffling.
+    //    -dealer M  : how the dealer's hand is played out,
+    //                 sequential, batched, alias, or expected.
+    //    -start M   : how starting states are chosen,
+    //                 fixed, dealt, exploring, or stratified.
+    //    -init V    : initial value estimates, hashed or a constant V.
+    //    -sampling M : importance sampling of the off-policy learners,
+    //                  ordinary, weighted, or per-decision.
+    //    -checkpoint F  : save the training state to F after training.
+    //    -checkpoint-every N : also save it every N iterations.
+    //    -resume F  : resume training from the checkpoint F.
+    //    -report-every N : print progress every N iterations, 0 to disable.
+    //    -check-every N  : check convergence every N iterations.
+    //    -reference F : compare the policy to the strategy in the checkpoint F,
+    //                   or to the exact solution if F is dp.
+    //    -stop-after K   : stop once the policy has been stable for K checks.
+    //    -stop-delta D   : values must also change by at most D to be stable.
+    //    -stop-agreement A : stop once the agreement with the reference reaches A.
+    //    -trace F   : write trace records to F, requires a build with TRACE > 0.
+    unsigned nthreads = 1;
+    int batch = 0;
+    bool pipeline = false;
+    unsigned long long publish_every = DEFAULT_PUBLISH_EVERY;
+    bool hogwild = false;
+    double alpha = DEFAULT_ALPHA;
+    double lambda = 0;
+    unsigned long long report_every = max(1ULL, niters/10);
+    const char* checkpoint_path = NULL;
+    unsigned long long checkpoint_every = 0;
+    const char* resume_path = NULL;
+    const char* trace_path = NULL;
+    unsigned long long check_every = 0;
+    const char* reference_path = NULL;
+    StoppingCriterion criterion = {0, HUGE_VAL, HUGE_VAL};
+    int ndecks = 0;
+    double penetration = 0.75;
+    DealerMode dealer_mode = BatchedDealer;
+    StartMode start_mode = DealtStart;
+    ValueInit value_init = HashedInit;
+    double init_value = 0;
+    ImportanceSampling sampling = WeightedSampling;
+    for (; i < argc; i++) {
+        if (strcmp(argv[i], "-threads") == 0 && i+1 < argc) {
+            nthreads = stoul(argv[++i]);
+            if (nthreads < 1) {
+                cerr << "-threads must be at least 1." << endl;
+                return EXIT_FAILURE;
+            }
+            cout << "Threads = " << nthreads << endl;
+        } else if (strcmp(argv[i], "-batch") == 0 && i+1 < argc) {
+            batch = stoi(argv[++i]);
+            cout << "Batch = " << batch << endl;
+        } else if (strcmp(argv[i], "-pipeline") == 0) {
+            pipeline = true;
+            cout << "Pipeline" << endl;
+        } else if (strcmp(argv[i], "-publish-every") == 0 && i+1 < argc) {
+            publish_every = stoull(argv[++i]);
+            cout << "Publish every = " << publish_every << endl;
+        } else if (strcmp(argv[i], "-alpha") == 0 && i+1 < argc) {
+            alpha = atof(argv[++i]);
+            cout << "Alpha = " << alpha << endl;
+        } else if (strcmp(argv[i], "-lambda") == 0 && i+1 < argc) {
+            lambda = atof(argv[++i]);
+            cout << "Lambda = " << lambda << endl;
+        } else if (strcmp(argv[i], "-hogwild") == 0) {
+            hogwild = true;
+            cout << "Hogwild" << endl;
+        } else if (strcmp(argv[i], "-seed") == 0 && i+1 < argc) {
+            seed = stoull(argv[++i]);
+        } else if (strcmp(argv[i], "-decks") == 0 && i+1 < argc) {
+            ndecks = stoi(argv[++i]);
+            if (ndecks < MIN_DECKS || ndecks > MAX_DECKS) {
+                cerr << "-decks must be between " << MIN_DECKS << " and " << MAX_DECKS << "." << endl;
+                return EXIT_FAILURE;
+            }
+            cout << "Decks = " << ndecks << endl;
+        } else if (strcmp(argv[i], "-penetration") == 0 && i+1 < argc) {
+            penetration = atof(argv[++i]);
+            if (!(penetration > 0 && penetration <= 1)) {
+                cerr << "-penetration must be in (0, 1]." << endl;
+                return EXIT_FAILURE;
+            }
+            cout << "Penetration = " << penetration << endl;
+        } else if (strcmp(argv[i], "-dealer") == 0 && i+1 < argc) {
+            i++;
+            if (strcmp(argv[i], "sequential") == 0) {
+                dealer_mode = SequentialDealer;
+            } else if (strcmp(argv[i], "batched") == 0) {
+                dealer_mode = BatchedDealer;
+            } else if (strcmp(argv[i], "alias") == 0) {
+                dealer_mode = AliasDealer;
+            } else if (strcmp(argv[i], "expected") == 0) {
+                dealer_mode = ExpectedDealer;
+            } else {
+                cerr << "Unrecognized dealer mode!" << endl;
+                return EXIT_FAILURE;
+            }
+            cout << "Dealer = " << argv[i] << endl;
+        } else if (strcmp(argv[i], "-start") == 0 && i+1 < argc) {
+            i++;
+            if (strcmp(argv[i], "fixed") == 0) {
+                start_mode = FixedStart;
+            } else if (strcmp(argv[i], "dealt") == 0) {
+                start_mode = DealtStart;
+            } else if (strcmp(argv[i], "exploring") == 0) {
+                start_mode = ExploringStart;
+            } else if (strcmp(argv[i], "stratified") == 0) {
+                start_mode = StratifiedStart;
+            } else {
+                cerr << "Unrecognized start mode!" << endl;
+                return EXIT_FAILURE;
+            }
+            cout << "Start = " << argv[i] << endl;
+        } else if (strcmp(argv[i], "-init") == 0 && i+1 < argc) {
+            i++;
+            if (strcmp(argv[i], "hashed") == 0) {
+                value_init = HashedInit;
+            } else {
+                value_init = ConstantInit;
+                init_value = atof(argv[i]);
+            }
+            cout << "Init = " << argv[i] << endl;
+        } else if (strcmp(argv[i], "-sampling") == 0 && i+1 < argc) {
+            i++;
+            if (strcmp(argv[i], "ordinary") == 0) {
+                sampling = OrdinarySampling;
+            } else if (strcmp(argv[i], "weighted") == 0) {
+                sampling = WeightedSampling;
+            } else if (strcmp(argv[i], "per-decision") == 0) {
+                sampling = PerDecisionSampling;
+            } else {
+                cerr << "Unrecognized importance sampling!" << endl;
+                return EXIT_FAILURE;
+            }
+            cout << "Sampling = " << argv[i] << endl;
+        } else if (strcmp(argv[i], "-checkpoint") == 0 && i+1 < argc) {
+            checkpoint_path = argv[++i];
+            cout << "Checkpoint = " << checkpoint_path << endl;
+        } else if (strcmp(argv[i], "-checkpoint-every") == 0 && i+1 < argc) {
+            checkpoint_every = stoull(argv[++i]);
+            cout << "Checkpoint every = " << checkpoint_every << endl;
+        } else if (strcmp(argv[i], "-resume") == 0 && i+1 < argc) {
+            resume_path = argv[++i];
+            cout << "Resume = " << resume_path << endl;
+        } else if (strcmp(argv[i], "-report-every") == 0 && i+1 < argc) {
+            report_every = stoull(argv[++i]);
+            cout << "Report every = " << report_every << endl;
+        } else if (strcmp(argv[i], "-check-every") == 0 && i+1 < argc) {
+            check_every = stoull(argv[++i]);
+            cout << "Check every = " << check_every << endl;
+        } else if (strcmp(argv[i], "-reference") == 0 && i+1 < argc) {
+            reference_path = argv[++i];
+            cout << "Reference = " << reference_path << endl;
+        } else if (strcmp(argv[i], "-stop-after") == 0 && i+1 < argc) {
+            criterion.patience = stoi(argv[++i]);
+            cout << "Stop after = " << criterion.patience << endl;
+        } else if (strcmp(argv[i], "-stop-delta") == 0 && i+1 < argc) {
+            criterion.max_delta = atof(argv[++i]);
+            cout << "Stop delta = " << criterion.max_delta << endl;
+        } else if (strcmp(argv[i], "-stop-agreement") == 0 && i+1 < argc) {
+            criterion.min_agreement = atof(argv[++i]);
+            cout << "Stop agreement = " << criterion.min_agreement << endl;
+        } else if (strcmp(argv[i], "-trace") == 0 && i+1 < argc) {
+            trace_path = argv[++i];
+            if (TRACE_LEVEL == 0) {
+                cerr << "Tracing is compiled out, rebuild with make TRACE=N" << endl;
+                return EXIT_FAILURE;
+            }
+            cout << "Trace = " << trace_path << endl;
+        } else {
+            cerr << "Unrecognized argument: " << argv[i] << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    // The seed is always shown, so that any run can be reproduced.
+    cout << "Seed = " << seed << endl;
     cout << endl;
+    if (batch > 0 && nthreads > 1 && !pipeline) {
+        cerr << "-batch can only be combined with -threads in a -pipeline." << endl;
+        return EXIT_FAILURE;
+    }
+    if (td && (nthreads > 1 || batch > 0 || pipeline)) {
+        cerr << "The TD learners update online on a single thread." << endl;
+        return EXIT_FAILURE;
+    }
+    if (criterion.min_agreement <= 1 && reference_path == NULL) {
+        cerr << "-stop-agreement requires a -reference." << endl;
+        return EXIT_FAILURE;
+    }
+    // Pipelined batches default to 64 episodes.
+    if (pipeline && batch == 0) batch = 64;
+    TrainOptions options = {isOnPolicy, td, method, alpha, lambda, 
+                            nthreads, batch, pipeline, publish_every};
 
-    // Train the agent.
-    isOnPolicy ? onPolicyLearner(agent, niters) : offPolicyLearner(agent, niters);
+    // Configure the environment.
+    generator.seed(seed);
+    if (ndecks > 0) useShoe(ndecks, penetration);
+    useDealer(dealer_mode);
+    useStarts(start_mode);
+    useValueInit(value_init, init_value);
+    useImportanceSampling(sampling);
+    if (trace_path != NULL && !traceOpen(trace_path)) return EXIT_FAILURE;
 
-    // Print action preferences after training.
-    if (!VERBOSE) {
+    // Create the agent.
+    Agent* agent = hogwild ? new Agent(new SharedValueTable, *policy) : new Agent(*policy);
+
+    // Load the reference strategy.
+    GreedyPolicy reference_policy;
+    Agent reference(reference_policy);
+    if (reference_path != NULL) {
+        if (strcmp(reference_path, "dp") == 0)
+            valueIterationSolver(&reference);
+        else if (!loadCheckpointValues(reference, reference_path))
+            return EXIT_FAILURE;
+    }
+
+    // Report progress while training, and track convergence if a
+    // reference or a stopping criterion is given.
+    bool tracking = check_every > 0 || reference_path != NULL || criterion.patience > 0;
+    if (tracking && check_every == 0) check_every = max(1ULL, niters/100);
+    PolicyMatrixPrinter printer(report_every);
+    ConvergenceTracker tracker(check_every, criterion, 
+                               reference_path != NULL ? &reference : NULL);
+    vector<TrainingObserver*> observers;
+    if (report_every > 0) observers.push_back(&printer);
+    if (tracking) observers.push_back(&tracker);
+    ObserverGroup group(observers);
+    TrainingObserver* observer = NULL;
+    if (observers.size() == 1) observer = observers[0];
+    if (observers.size() > 1) observer = &group;
+
+    // Restore the agent's training state.
+    unsigned long long done = 0;
+    if (resume_path != NULL) {
+        if (!loadCheckpoint(*agent, done, resume_path)) return EXIT_FAILURE;
+        cout << "Resuming after " << done << " iterations" << endl;
         cout << endl;
-        cout << "After training:" << endl;
-        agent->printPolicyMatrix();
     }
+
+    // Train the agent.
+    // With periodic checkpoints, training is split into chunks
+    // with a checkpoint saved after each one.
+    unsigned long long chunk = (checkpoint_path != NULL && checkpoint_every > 0) ? 
+        checkpoint_every : niters;
+    while (done < niters) {
+        unsigned long long n = min(chunk, niters - done);
+        trainer(agent, options, n, observer);
+        if (tracker.shouldStop()) {
+            done += tracker.stoppedAt();
+            cout << "Stopped early after " << done << " iterations" << endl;
+        } else {
+            done += n;
+        }
+        if (checkpoint_path != NULL && !saveCheckpoint(*agent, done, checkpoint_path))
+            return EXIT_FAILURE;
+        if (tracker.shouldStop()) break;
+    }
+
+    traceClose();
+
+    // Print action preferences after training.
+    cout << endl;
+    cout << "After training:" << endl;
+    agent->printPolicyMatrix();
     
     return 0;
 }
\ No newline at end of file
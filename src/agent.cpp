@@ -5,7 +5,7 @@
 
 #include "agent.hpp"
 #include "environment.hpp"
-#include "verbose.hpp"
+#include "trace.hpp"
 
 // Gets the value estimate corresponding to the given state-action pair.
 // If the state-action pair hasn't been seen before, then a random value
@@ -18,19 +18,9 @@
 //             or a random initial value.
 //
 AvgReturn* Agent::getStateActionValue(const State* state, const Action action) {
-    // If the state-action pair doesn't exist, then create it.
-    if (m_values->find({*state, action}) == m_values->end()) {
-        m_values->insert({{*state, action}, new AvgReturn()});
-    }
-    // Log.
-    /*
-    if (VERBOSE) {
-        cout << "Get: (" << *state << ", " << action << ") -> " 
-             << *(m_values->at({*state, action})) << endl;
-    }
-    */
-    // Return the value in the hash associated to the state-action pair.
-    return m_values->at({*state, action});
+    // Return the value in the table associated to the state-action pair.
+    // If the state-action pair doesn't exist, then it is created.
+    return m_values->get(*state, action);
 }
 
 // This function updates the average return value for the state action pair.
@@ -38,104 +28,49 @@ AvgReturn* Agent::getStateActionValue(const State* state, const Action action) {
 // If the agent doesn't have a value estimate yet for the state action pair,
 // then one is created in the values hash.
 //
+// Thread-safe if the agent's value table is concurrent.
+//
 void Agent::updateStateActionValue(const State* state, const Action action, const double rtrn) {
-    // Lookup the state-action pair in the agent's value map.
-    // If the state-action pair doesn't exist, then create one.
-    if (m_values->find({*state, action}) == m_values->end())
-        m_values->insert({{*state, action}, new AvgReturn()});
-    // Log before update
-    if (VERBOSE) {
-        cout << "Updating value est. w/ " << rtrn << endl;
-        cout << "Before: (" << *state << ", " << action << ") -> " 
-             << *(m_values->at({*state, action})) << endl;
-    }
     // Update the value estimate for the state-action pair.
-    m_values->at({*state, action})->update(rtrn);
-    // Log after update
-    if (VERBOSE) {
-        cout << "After: (" << *state << ", " << action << ") -> " 
-             << *(m_values->at({*state, action})) << endl;
-    }
+    // If the state-action pair doesn't exist, then create one.
+    [[maybe_unused]] double value = m_values->update(*state, action, rtrn);
+    TRACE(TRACE_UPDATES, traceUpdate(*state, action, rtrn, value));
 }
 
 // This function updates the value estimate corresponding to the given state-action pair.
-// The 'strength' of the update is scaled by the weight parameter alpha.
+// The 'strength' of the update is scaled by the weight of the return.
 //
 // Input:
 //  - state-action pair to be updated.
 //  - the return associated with the sa-pair.
-//  - the weight parameter 'alpha' which acts as a learning rate.
+//  - the weight of the return in the pair's weighted average.
+//
+// Thread-safe if the agent's value table is concurrent.
 //
 void Agent::weightedUpdateStateActionValue(const State* state, const Action action, 
-                                           const double rtrn, const double alpha) {
-    // Look up the state-action pair in the agent's value map.
-    // If the state-action pair doesn't exist, then create one.
-    if (m_values->find({*state, action}) == m_values->end()) {
-        if (VERBOSE) cout << "Couldnt find " << *state << endl;
-        m_values->insert({{*state, action}, new AvgReturn()});
-    }
+                                           const double rtrn, const double weight) {
     // Update the value estimate for the state-action pair.
-    double q = m_values->at({*state, action})->value();
-    m_values->at({*state, action})->setValue(q + alpha*(rtrn - q));
-    // Log after update
-    if (VERBOSE) {
-        cout << "q=" << q << " alpha=" << alpha << " rtrn=" << rtrn << endl;
-        cout << "Updated value=" << m_values->at({*state, action})->value() << endl;
-    }
-}
-
-map<Action, AvgReturn*> Agent::getActionValues(const State* state) {
-    // Map the agent's value estimates onto the set of valid actions.
-    map<Action, AvgReturn*> values;
-    set<Action> actions({Hit, Stay});
-    set<Action>::iterator itr;
-    for (itr=actions.begin(); itr!=actions.end(); itr++) {
-        values[*itr] = getStateActionValue(state, *itr);
-    }
-    return values;
-}
-
-
-// This function returns the probability of the agent taking a given action in a given state.
-//
-double Agent::actionProbability(const Action action, const State* state) {
-    // Use the policy to select an action.
-    return m_policy.actionProbability(action, getActionValues(state));
+    // If the state-action pair doesn't exist, then create one.
+    [[maybe_unused]] double value = m_values->weightedUpdate(*state, action, rtrn, weight);
+    TRACE(TRACE_UPDATES, traceUpdate(*state, action, rtrn, value));
 }
 
-// Given a state, the agent must use its policy and state-action value
-// estimates to select a valid action.
+// This function steps the value estimate corresponding to the given
+// state-action pair towards a target.
 //
 // Input:
-//    - state
-// Output:
-//    - action to be taken determined by the agent's policy.
+//  - state-action pair to be updated.
+//  - the target associated with the sa-pair.
+//  - the step size 'alpha' which acts as a learning rate.
+//  - the weight added to the estimate's weight.
 //
-Action Agent::getAction(const State* state) {
-    // Use the policy to select an action.
-    return m_policy.select(getActionValues(state));
-}
-
-// Given a state, the agent must use its policy to select an action.
-// This action then transfoms the state to the next state and a reward
-// is recieved.
+// Thread-safe if the agent's value table is concurrent.
 //
-// Input:
-//    - state: the current state
-// Output:
-//    - _action: the action taken by the agent
-//    - _reward: the reward recieved
-//    - Returns the next state after the action has been taken
-//
-Reward Agent::act(const State* state, Action& _action, State** _state) {
-    // Use the action to transform the state to the next state.
-    State* p_next_state = nullptr;
-    Action action = getAction(state);
-    Reward reward = transform(state, action, &p_next_state);
-    // Populate the return values
-    _action = action;
-    *_state = p_next_state;
-    return reward;
+void Agent::stepStateActionValue(const State* state, const Action action,
+                                 const double target, const double alpha,
+                                 const double weight) {
+    [[maybe_unused]] double value = m_values->step(*state, action, target, alpha, weight);
+    TRACE(TRACE_UPDATES, traceUpdate(*state, action, target, value));
 }
 
 // Get the gready action based on the agent's state-action value estimates.
@@ -146,28 +81,36 @@ Reward Agent::act(const State* state, Action& _action, State** _state) {
 //    - the output that maximizes the agent's expected return.
 //
 Action Agent::getGreedyAction(const State* state) {
-    // Use a greedy policy to select an action.
-    GreedyPolicy greedy;
-    return greedy.select(getActionValues(state));
+    // Select the action with the greatest value.
+    return greedyAction(getActionValues(state));
 }
 
-// This function prints a table of the agent's greedy action for every
-// valid state.
+// Gets the greedy action without modifying the agent's estimates.
+// Actions which haven't been seen before are ignored.
 //
+// Input:
+//    - current state
+// Output:
+//    - _action: the action with the greatest value estimate
+//    - Returns false if no action has been seen in the state.
 //
-void Agent::printPolicyMatrix() {
-    // Table dimensions
-    // Dealer face up card values: [2, 11]
-    // Player count values: [2, 20]
-    int MAX_COUNT = 20; int MAX_DEALER = 11;
-    int count; int dealer;
-    //
-    // Print hard table
-    //
-    // Print column labels
-    cout << "--> Hard" << endl;
-    cout << "   ";
-    for (dealer=2; dealer<=MAX_DEALER; dealer++) {
+bool Agent::peekGreedyAction(const State* state, Action& _action) const {
+    const AvgReturn* best = nullptr;
+    for (int a=0; a<state->numActions(); a++) {
+        const AvgReturn* value = peekStateActionValue(state, (Action) a);
+        if (value != nullptr && (best == nullptr || best->value() < value->value())) {
+            best = value;
+            _action = (Action) a;
+        }
+    }
+    return best != nullptr;
+}
+
+// Prints the column labels of a policy table, one per dealer card.
+//
+static void printDealerLabels() {
+    cout << "    ";
+    for (int dealer=2; dealer<=11; dealer++) {
         if (dealer == 10) {
             cout << "T";
         } else if (dealer == 11) {
@@ -178,67 +121,97 @@ void Agent::printPolicyMatrix() {
         cout << " ";
     }
     cout << endl;
-    // Print rows
-    State state;
+}
+
+// Prints the agent's greedy action against each dealer card, for the
+// player's hand in the given state.
+//
+static void printPolicyRow(const Agent& agent, State state) {
     Action action;
-    for (count=4; count<=MAX_COUNT; count++) {
-        // Print the row label
-        if (count < 10) {cout << " ";}
-        cout << count << " ";
-        // Print the action preferences for the row
-        for (dealer=2; dealer<=MAX_DEALER; dealer++) {
-            // Get the agent's greedy action
-            state = State(count, dealer, 0);
-            action = getGreedyAction(&state);
-            //cout << "HERE" << endl;
-            // Print the action abbreviation.
-            if (action == Hit) {
-                cout << "H ";
-            } else if (action == Stay) {
-                cout << "S ";
-            } else {
-                cout << "? ";
-            }
+    for (int dealer=2; dealer<=11; dealer++) {
+        state.setDealer(dealer);
+        if (!agent.peekGreedyAction(&state, action)) {
+            cout << "? ";
+            continue;
         }
-        cout << endl;
+        // Print the action abbreviation.
+        cout << actionLetter(action) << " ";
+    }
+    cout << endl;
+}
+
+// This function prints a table of the agent's greedy action for every
+// valid state, as the first action of a dealt hand, followed by the
+// hit or stay tables of the hands which have already drawn a card.
+//
+// Actions are abbreviated as H(it), S(tay), D(ouble), (su)R(render)
+// and sP(lit).
+//
+// The agent's estimates are only read, so this is safe to call
+// in the middle of training.
+//
+void Agent::printPolicyMatrix() const {
+    // Table dimensions
+    // Dealer face up card values: [2, 11]
+    // Player count values: [5, 20]
+    // Note - a dealt hard 4 or 20 is always a pair.
+    int MAX_COUNT = 20;
+    int count;
+    //
+    // Print hard table
+    //
+    cout << "--> Hard" << endl;
+    printDealerLabels();
+    for (count=5; count<MAX_COUNT; count++) {
+        // Print the row label
+        cout << (count < 10 ? "  " : " ") << count << " ";
+        printPolicyRow(*this, State(count, 0, 0, Opening));
     }
     cout << endl;
     //
     // Print soft table
     //
-    // Print column labels
     cout << "--> Soft" << endl;
-    cout << "   ";
-    for (dealer=2; dealer<=MAX_DEALER; dealer++) {
-        if (dealer == 10) {
-            cout << "T";
-        } else if (dealer == 11) {
-            cout << "A";
-        } else {
-            cout << dealer;
-        }
-        cout << " ";
+    printDealerLabels();
+    for (count=13; count<=MAX_COUNT; count++) {
+        cout << " " << count << " ";
+        printPolicyRow(*this, State(count, 0, 1, Opening));
     }
     cout << endl;
-    // Print rows
-    for (count=12; count<=MAX_COUNT; count++) {
+    //
+    // Print pairs table
+    //
+    cout << "--> Pairs" << endl;
+    printDealerLabels();
+    for (int card=2; card<=11; card++) {
         // Print the row label
-        if (count < 10) {cout << " ";}
-        cout << count << " ";
-        // Print the action preferences for the row
-        for (dealer=2; dealer<=MAX_DEALER; dealer++) {
-            // Get the agent's greedy action
-            state = State(count, dealer, 1);
-            action = getGreedyAction(&state);
-            // Print the action abbreviation.
-            if (action == Hit) {
-                cout << "H ";
-            } else if (action == Stay) {
-                cout << "S ";
-            } else {
-                cout << "? ";
-            }
-        }
-        cout << endl;
+        char c = (card == 10) ? 'T' : (card == 11) ? 'A' : (char) ('0' + card);
+        cout << c << "," << c << " ";
+        // A pair of aces is a soft 12.
+        if (card == 11)
+            printPolicyRow(*this, State(12, 0, 1, Pair));
+        else
+            printPolicyRow(*this, State(2*card, 0, 0, Pair));
     }
-}
\ No newline at end of file
+    cout << endl;
+    //
+    // Print hard table after drawing
+    //
+    // Note - the lowest count after drawing is a pair of twos and a two.
+    cout << "--> Hard, drawn" << endl;
+    printDealerLabels();
+    for (count=6; count<=MAX_COUNT; count++) {
+        cout << (count < 10 ? "  " : " ") << count << " ";
+        printPolicyRow(*this, State(count, 0, 0, Drawn));
+    }
+    cout << endl;
+    //
+    // Print soft table after drawing
+    //
+    cout << "--> Soft, drawn" << endl;
+    printDealerLabels();
+    for (count=13; count<=MAX_COUNT; count++) {
+        cout << " " << count << " ";
+        printPolicyRow(*this, State(count, 0, 1, Drawn));
+    }
+}
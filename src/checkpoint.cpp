@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "seed.hpp"
+#include "valuetable.hpp"
+
+// Converts a field between the host's byte order and the little-endian
+// order of the file. Swapping is its own inverse, so the same function
+// is used for saving and loading.
+//
+template <class T>
+static void convertByteOrder(T& field) {
+    if constexpr (endian::native == endian::big) {
+        unsigned char* bytes = (unsigned char*) &field;
+        reverse(bytes, bytes + sizeof(T));
+    }
+}
+
+static void convertByteOrder(CheckpointHeader& header) {
+    convertByteOrder(header.version);
+    convertByteOrder(header.num_entries);
+    convertByteOrder(header.episodes);
+    for (int i=0; i<NUM_POLICY_COUNTERS; i++)
+        convertByteOrder(header.policy_counters[i]);
+}
+
+static void convertByteOrder(CheckpointEntry& entry) {
+    convertByteOrder(entry.value);
+    convertByteOrder(entry.weight);
+}
+
+// Saves the agent's value estimates and their weights, policy counters,
+// and the main thread's random number generator state.
+//
+// Input:
+//    - agent: the agent being trained.
+//    - episodes: the number of episodes trained so far.
+//    - path: the checkpoint file.
+// Output:
+//    - Whether the checkpoint was saved.
+//
+bool saveCheckpoint(Agent& agent, unsigned long long episodes, const string& path) {
+    // Fill in the header.
+    CheckpointHeader header = {};
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.num_entries = NUM_STATE_ACTIONS;
+    header.episodes = episodes;
+    unsigned long long counters[NUM_POLICY_COUNTERS] = {};
+    agent.policy().getCounters(counters);
+    for (int i=0; i<NUM_POLICY_COUNTERS; i++)
+        header.policy_counters[i] = counters[i];
+    ostringstream rng_state;
+    rng_state << generator;
+    strncpy(header.rng_state, rng_state.str().c_str(), sizeof(header.rng_state)-1);
+    // Fill in a record for each entry of the dense table.
+    vector<CheckpointEntry> entries(NUM_STATE_ACTIONS);
+    State state;
+    Action action;
+    for (int idx=0; idx<NUM_STATE_ACTIONS; idx++) {
+        DenseValueTable::decode(idx, state, action);
+        AvgReturn* value = agent.getStateActionValue(&state, action);
+        entries[idx].value = value->value();
+        entries[idx].weight = value->weight();
+    }
+    convertByteOrder(header);
+    for (CheckpointEntry& entry : entries)
+        convertByteOrder(entry);
+    // Write to a temporary file, then move it into place.
+    string tmp_path = path + ".tmp";
+    ofstream file(tmp_path, ios::binary | ios::trunc);
+    file.write((const char*) &header, sizeof(header));
+    file.write((const char*) entries.data(), entries.size()*sizeof(CheckpointEntry));
+    file.close();
+    if (!file || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        cerr << "Failed to save checkpoint: " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+// Reads and validates a checkpoint's header and records.
+//
+// Output:
+//    - header, entries: the checkpoint's contents.
+//    - Whether the checkpoint was read.
+//
+static bool readCheckpoint(const string& path, CheckpointHeader& header,
+                           vector<CheckpointEntry>& entries) {
+    ifstream file(path, ios::binary);
+    if (!file) {
+        cerr << "Failed to open checkpoint: " << path << endl;
+        return false;
+    }
+    // Read and validate the header.
+    file.read((char*) &header, sizeof(header));
+    if (!file || memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0) {
+        cerr << "Not a checkpoint file: " << path << endl;
+        return false;
+    }
+    convertByteOrder(header);
+    if (header.version != CHECKPOINT_VERSION || header.num_entries != NUM_STATE_ACTIONS) {
+        cerr << "Incompatible checkpoint version " << header.version 
+             << " with " << header.num_entries << " entries: " << path << endl;
+        return false;
+    }
+    // Read the records in a single pass.
+    entries.resize(NUM_STATE_ACTIONS);
+    file.read((char*) entries.data(), entries.size()*sizeof(CheckpointEntry));
+    if (!file) {
+        cerr << "Truncated checkpoint: " << path << endl;
+        return false;
+    }
+    for (CheckpointEntry& entry : entries)
+        convertByteOrder(entry);
+    return true;
+}
+
+// Loads a checkpoint saved by saveCheckpoint into the agent.
+//
+// Input:
+//    - agent: the agent to restore, its policy must have the same type
+//             as the policy used when saving.
+//    - path: the checkpoint file.
+// Output:
+//    - episodes: the number of episodes trained before the checkpoint.
+//    - Whether the checkpoint was loaded.
+//
+bool loadCheckpoint(Agent& agent, unsigned long long& episodes, const string& path) {
+    CheckpointHeader header;
+    vector<CheckpointEntry> entries;
+    if (!readCheckpoint(path, header, entries)) return false;
+    // Restore the agent.
+    State state;
+    Action action;
+    for (int idx=0; idx<NUM_STATE_ACTIONS; idx++) {
+        DenseValueTable::decode(idx, state, action);
+        agent.getStateActionValue(&state, action)->restore(
+            entries[idx].value, entries[idx].weight);
+    }
+    unsigned long long counters[NUM_POLICY_COUNTERS];
+    for (int i=0; i<NUM_POLICY_COUNTERS; i++)
+        counters[i] = header.policy_counters[i];
+    agent.policy().setCounters(counters);
+    istringstream rng_state(string(header.rng_state, strnlen(header.rng_state, sizeof(header.rng_state))));
+    rng_state >> generator;
+    episodes = header.episodes;
+    return true;
+}
+
+// Loads only the value estimates of a checkpoint into the agent.
+//
+// The agent's policy and the random number generator are left untouched,
+// so this can be used to load a reference strategy in the middle of a run.
+//
+bool loadCheckpointValues(Agent& agent, const string& path) {
+    CheckpointHeader header;
+    vector<CheckpointEntry> entries;
+    if (!readCheckpoint(path, header, entries)) return false;
+    State state;
+    Action action;
+    for (int idx=0; idx<NUM_STATE_ACTIONS; idx++) {
+        DenseValueTable::decode(idx, state, action);
+        agent.getStateActionValue(&state, action)->restore(
+            entries[idx].value, entries[idx].weight);
+    }
+    return true;
+}
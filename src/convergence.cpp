@@ -0,0 +1,132 @@
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "convergence.hpp"
+#include "environment.hpp"
+#include "start.hpp"
+
+// Marks the states that can be reached from a dealt hand, following the
+// same dynamics as transform and dealSplitHand.
+//
+static void findReachable(bool reachable[NUM_STATES]) {
+    for (int i=0; i<NUM_STATES; i++) reachable[i] = false;
+    vector<State> stack;
+    for (int i=0; i<NUM_START_STATES; i++) {
+        stack.push_back(start_distribution.state(i));
+        reachable[stack.back().index()] = true;
+    }
+    auto visit = [&](State next) {
+        if (!checkTerminal(&next) && !reachable[next.index()]) {
+            reachable[next.index()] = true;
+            stack.push_back(next);
+        }
+    };
+    while (!stack.empty()) {
+        State state = stack.back();
+        stack.pop_back();
+        for (int card=2; card<=11; card++) {
+            // Hitting
+            visit(State(state.count()+card, state.dealer(),
+                        state.usableAces() + (card == 11)));
+            // Splitting
+            if (state.phase() == Pair) {
+                int first = pairCard(&state);
+                visit(State(first+card, state.dealer(),
+                            (first == 11) + (card == 11), SplitHand));
+            }
+        }
+    }
+}
+
+// Gets the agent's greedy action in the state, or -1 if the state
+// hasn't been seen.
+//
+static int greedyAction(const Agent& agent, const State& state) {
+    Action action;
+    return agent.peekGreedyAction(&state, action) ? action : -1;
+}
+
+ConvergenceTracker::ConvergenceTracker(unsigned long long interval, 
+                                       const StoppingCriterion& criterion,
+                                       const Agent* reference) :
+    TrainingObserver(interval),
+    m_criterion(criterion),
+    m_has_reference(reference != nullptr),
+    m_checks(0),
+    m_stable(0),
+    m_last({0, 0, -1, -1}),
+    m_stop(false),
+    m_stopped_at(0) {
+    findReachable(m_reachable);
+    for (int idx=0; idx<NUM_STATES; idx++) {
+        State state = State::fromIndex(idx);
+        m_actions[idx] = -1;
+        m_reference[idx] = m_has_reference ? greedyAction(*reference, state) : -1;
+        m_reference_split[idx] = 0;
+        if (m_has_reference && state.phase() == Pair) {
+            const AvgReturn* value = reference->peekStateActionValue(&state, Split);
+            m_reference_split[idx] = (value == nullptr) ? 0 : value->value();
+        }
+    }
+    for (int idx=0; idx<NUM_STATE_ACTIONS; idx++)
+        m_values[idx] = 0;
+}
+
+// Compares the agent's estimates to those at the previous check and to
+// the reference, then updates the stopping condition.
+//
+void ConvergenceTracker::onProgress(const Agent& agent, const Progress& progress) {
+    Convergence metrics = {0, 0, -1, -1};
+    int nreachable = 0;
+    int nagree = 0;
+    // Greedy actions
+    for (int idx=0; idx<NUM_STATES; idx++) {
+        if (!m_reachable[idx]) continue;
+        State state = State::fromIndex(idx);
+        int action = greedyAction(agent, state);
+        if (action != m_actions[idx]) metrics.flips++;
+        m_actions[idx] = action;
+        if (action == m_reference[idx])
+            nagree++;
+        nreachable++;
+    }
+    // Values
+    State state;
+    Action action;
+    for (int idx=0; idx<NUM_STATE_ACTIONS; idx++) {
+        DenseValueTable::decode(idx, state, action);
+        if (!m_reachable[state.index()]) continue;
+        const AvgReturn* value = agent.peekStateActionValue(&state, action);
+        double q = (value == nullptr) ? 0 : value->value();
+        metrics.max_delta = max(metrics.max_delta, fabs(q - m_values[idx]));
+        m_values[idx] = q;
+        if (m_has_reference && action == Split)
+            metrics.split_error = max(metrics.split_error, 
+                                      fabs(q - m_reference_split[state.index()]));
+    }
+    if (m_has_reference)
+        metrics.agreement = (double) nagree / nreachable;
+    m_last = metrics;
+    // The first check has nothing to compare against.
+    if (m_checks++ == 0) {
+        if (m_has_reference)
+            cout << "--> agreement = " << 100*metrics.agreement << "%"
+                 << "  max split error = " << metrics.split_error << endl;
+        return;
+    }
+    cout << "--> flips = " << metrics.flips 
+         << "  max |dQ| = " << metrics.max_delta;
+    if (m_has_reference)
+        cout << "  agreement = " << 100*metrics.agreement << "%"
+             << "  max split error = " << metrics.split_error;
+    cout << endl;
+    // Check the stopping criterion.
+    bool stable = metrics.flips == 0 && metrics.max_delta <= m_criterion.max_delta;
+    m_stable = stable ? m_stable+1 : 0;
+    if ((m_criterion.patience > 0 && m_stable >= m_criterion.patience) ||
+        (m_has_reference && metrics.agreement >= m_criterion.min_agreement)) {
+        m_stop = true;
+        m_stopped_at = progress.iteration;
+    }
+}
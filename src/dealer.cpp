@@ -0,0 +1,193 @@
+#include <cstdint>
+
+#include "dealer.hpp"
+#include "environment.hpp"
+#include "seed.hpp"
+
+const DealerDistribution dealer_distribution;
+
+// Gets the probability of the dealer finishing from the given count and
+// usable aces with each outcome, dealing from an infinite deck.
+//
+// Results are memoized per (count, soft) since at most one ace can be
+// usable while the dealer is below 17.
+//
+static const double* finalDistribution(int count, int usable_aces,
+                                       double memo[][2][NUM_DEALER_OUTCOMES],
+                                       bool done[][2]) {
+    bool soft = usable_aces > 0;
+    if (done[count][soft]) return memo[count][soft];
+    double* probs = memo[count][soft];
+    for (int o=0; o<NUM_DEALER_OUTCOMES; o++) probs[o] = 0;
+    if (count >= 17) {
+        // The dealer stands.
+        probs[count > 21 ? NUM_DEALER_OUTCOMES-1 : count-17] = 1;
+    } else {
+        // The dealer hits, ten valued cards are 4 of the 13 cards.
+        for (int card=2; card<=11; card++) {
+            double p_card = (card == 10 ? 4.0 : 1.0)/13.0;
+            int next_count = count + card;
+            int next_aces = usable_aces + (card == 11);
+            if (next_count > 21 && next_aces > 0) {
+                next_count -= 10;
+                next_aces--;
+            }
+            const double* next = finalDistribution(next_count, next_aces, memo, done);
+            for (int o=0; o<NUM_DEALER_OUTCOMES; o++)
+                probs[o] += p_card*next[o];
+        }
+    }
+    done[count][soft] = true;
+    return probs;
+}
+
+// Computes the dealer outcome distribution, expected rewards, and alias
+// tables for every up card.
+//
+DealerDistribution::DealerDistribution() {
+    double memo[MAX_PLAYER_COUNT+1][2][NUM_DEALER_OUTCOMES];
+    bool done[MAX_PLAYER_COUNT+1][2] = {};
+    for (int u=0; u<NUM_UP_CARDS; u++) {
+        int up_card = u + MIN_UP_CARD;
+        // Outcome distribution
+        const double* probs = finalDistribution(up_card, up_card == 11, memo, done);
+        for (int o=0; o<NUM_DEALER_OUTCOMES; o++)
+            m_probs[u][o] = probs[o];
+        // Expected reward for each player count
+        for (int count=0; count<=MAX_PLAYER_COUNT; count++) {
+            m_expected[count][u] = 0;
+            for (int o=0; o<NUM_DEALER_OUTCOMES; o++)
+                m_expected[count][u] += m_probs[u][o]*(double) determineWinner(count, 17+o);
+        }
+        // Alias table (Vose's method)
+        double scaled[NUM_DEALER_OUTCOMES];
+        int small[NUM_DEALER_OUTCOMES], large[NUM_DEALER_OUTCOMES];
+        int nsmall = 0, nlarge = 0;
+        for (int o=0; o<NUM_DEALER_OUTCOMES; o++) {
+            scaled[o] = m_probs[u][o]*NUM_DEALER_OUTCOMES;
+            if (scaled[o] < 1) small[nsmall++] = o;
+            else large[nlarge++] = o;
+        }
+        while (nsmall > 0 && nlarge > 0) {
+            int s = small[--nsmall];
+            int l = large[--nlarge];
+            m_alias_probs[u][s] = scaled[s];
+            m_aliases[u][s] = l;
+            scaled[l] = (scaled[l] + scaled[s]) - 1;
+            if (scaled[l] < 1) small[nsmall++] = l;
+            else large[nlarge++] = l;
+        }
+        // Remaining columns are full, up to rounding error.
+        while (nlarge > 0) {
+            int l = large[--nlarge];
+            m_alias_probs[u][l] = 1;
+            m_aliases[u][l] = l;
+        }
+        while (nsmall > 0) {
+            int s = small[--nsmall];
+            m_alias_probs[u][s] = 1;
+            m_aliases[u][s] = s;
+        }
+    }
+}
+
+// Gets the probability of the dealer finishing with the given count.
+// Any count over 21 is a bust.
+//
+double DealerDistribution::probability(int up_card, int final_count) const {
+    if (final_count < 17) return 0;
+    int o = final_count > 21 ? NUM_DEALER_OUTCOMES-1 : final_count-17;
+    return m_probs[up_card - MIN_UP_CARD][o];
+}
+
+// Draws the dealer's final count for the up card using the alias table.
+// A single uniform number picks both the column and the coin flip.
+//
+int DealerDistribution::sample(int up_card) const {
+    double x = generator.uniform() * NUM_DEALER_OUTCOMES;
+    int column = (int) x;
+    if (column == NUM_DEALER_OUTCOMES) column--;
+    int u = up_card - MIN_UP_CARD;
+    int o = (x - column < m_alias_probs[u][column]) ? column : m_aliases[u][column];
+    return 17 + o;
+}
+
+// Maps a random number onto the value of one of the 13 cards:
+// 0-7 -> 2-9, 8-11 -> 10, 12 -> ace (11).
+//
+static inline int32_t drawCard(uint32_t& rng) {
+    // Advance the xorshift stream.
+    uint32_t x = rng;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    rng = x;
+    int32_t idx = (int32_t) (((uint64_t) x * 13) >> 32);
+    return (idx + 2 < 10 ? idx + 2 : 10) + (idx == 12);
+}
+
+// Plays out n dealer hands at once.
+//
+// The dealer hits below 17 and stands on soft 17.
+// Each hand's xorshift stream is seeded from a bulk draw of the
+// thread's generator at the start of the batch.
+//
+// Most hands stand after two or three cards, so once only a few hands
+// are still drawing they are finished one at a time rather than
+// running full rounds for all of the hands.
+//
+void playDealerBatch(const int* up_cards, int* final_counts, int n) {
+    // Structure of arrays hand state.
+    int32_t count[DEALER_BATCH_SIZE];
+    int32_t usable_aces[DEALER_BATCH_SIZE];
+    uint32_t rng[DEALER_BATCH_SIZE];
+    // Initialize the hands using the face up cards.
+    uint64_t seeds[DEALER_BATCH_SIZE];
+    generator.fill(seeds, n);
+    for (int i=0; i<n; i++) {
+        count[i] = up_cards[i];
+        usable_aces[i] = (up_cards[i] == 11);
+        // The xorshift state must be non-zero.
+        rng[i] = (uint32_t) seeds[i] | 1;
+    }
+    // Every hand draws a card each round. Hands which are already
+    // standing ignore the card.
+    int active = n;
+    while (active > n/8) {
+        active = 0;
+        for (int i=0; i<n; i++) {
+            int32_t card = drawCard(rng[i]);
+            // Only hands below 17 take the card.
+            int32_t hit = count[i] < 17;
+            count[i] += hit * card;
+            usable_aces[i] += hit & (card == 11);
+            // Count a usable ace as 1 if the hand went over 21.
+            int32_t soften = (count[i] > 21) & (usable_aces[i] > 0);
+            count[i] -= soften * 10;
+            usable_aces[i] -= soften;
+            active += count[i] < 17;
+        }
+    }
+    // Finish the remaining hands one at a time.
+    for (int i=0; i<n; i++) {
+        while (count[i] < 17) {
+            int32_t card = drawCard(rng[i]);
+            count[i] += card;
+            usable_aces[i] += (card == 11);
+            if (count[i] > 21 && usable_aces[i] > 0) {
+                count[i] -= 10;
+                usable_aces[i]--;
+            }
+        }
+        final_counts[i] = count[i];
+    }
+}
+
+// Simulates a new batch of dealer outcomes for the up card.
+//
+void DealerOutcomes::refill(int up_card) {
+    int i = up_card - MIN_UP_CARD;
+    int up_cards[DEALER_BATCH_SIZE];
+    for (int j=0; j<DEALER_BATCH_SIZE; j++)
+        up_cards[j] = up_card;
+    playDealerBatch(up_cards, m_counts[i], DEALER_BATCH_SIZE);
+    m_cursor[i] = 0;
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "dealer.hpp"
+#include "dp.hpp"
+#include "environment.hpp"
+#include "valuetable.hpp"
+#include "trace.hpp"
+
+// Gets the state's value under the greedy policy.
+// The state's valid actions are contiguous in the table.
+//
+static double stateValue(const double* q, const State& state) {
+    const double* first = &q[DenseValueTable::index(state, Hit)];
+    return *max_element(first, first + state.numActions());
+}
+
+// Gets the probability of the given card being dealt.
+//
+static double cardProbability(int card) {
+    // Ten valued cards are 4 of the 13 cards.
+    return (card == 10 ? 4.0 : 1.0)/13.0;
+}
+
+// Computes the value of hitting in the given state from the current
+// estimates of the successor states' values.
+//
+// The successor states follow the same dynamics as transform, with cards
+// dealt from an infinite deck. Terminal successors are worth the exact
+// expected reward against the dealer's up card.
+//
+static double hitValue(const double* q, const State& state) {
+    double value = 0;
+    for (int card=2; card<=11; card++) {
+        double p_card = cardProbability(card);
+        State next(state.count()+card, state.dealer(), 
+                   state.usableAces() + (card == 11));
+        if (checkTerminal(&next))
+            value += p_card*dealer_distribution.expectedReward(next.count(), next.dealer());
+        else
+            value += p_card*stateValue(q, next);
+    }
+    return value;
+}
+
+// Computes the value of doubling in the given state, i.e. twice the
+// expected reward after exactly one more card.
+//
+static double doubleValue(const State& state) {
+    double value = 0;
+    for (int card=2; card<=11; card++) {
+        State next(state.count()+card, state.dealer(), 
+                   state.usableAces() + (card == 11));
+        checkTerminal(&next);
+        value += cardProbability(card)*
+                 dealer_distribution.expectedReward(next.count(), next.dealer());
+    }
+    return 2*value;
+}
+
+// Computes the value of splitting the pair in the given state from the
+// current estimates of the split hands' values.
+//
+// The split hands follow the same dynamics as dealSplitHand. Hands dealt
+// 21 stay, and the pair's value is the sum of the two hands' values.
+//
+static double splitValue(const double* q, const State& state) {
+    int first = pairCard(&state);
+    double value = 0;
+    for (int card=2; card<=11; card++) {
+        State hand(first+card, state.dealer(), (first == 11) + (card == 11), SplitHand);
+        if (checkTerminal(&hand))
+            value += cardProbability(card)*
+                     dealer_distribution.expectedReward(hand.count(), hand.dealer());
+        else
+            value += cardProbability(card)*stateValue(q, hand);
+    }
+    return 2*value;
+}
+
+// Computes the value of the state-action pair from the current estimates.
+//
+static double actionValue(const double* q, const State& state, Action action) {
+    switch (action) {
+        case Hit:
+            return hitValue(q, state);
+        case Stay:
+            return dealer_distribution.expectedReward(state.count(), state.dealer());
+        case Double:
+            return doubleValue(state);
+        case Surrender:
+            return -0.5;
+        case Split:
+            return splitValue(q, state);
+        default:
+            cerr << "Unrecognized action!" << endl;
+            abort();
+    }
+}
+
+// This function computes the exact optimal state-action values for the 
+// environment with value iteration.
+//
+// Input:
+//    - agent: the agent whose estimates are overwritten with the solution.
+//    - theta: the sweeps stop once no value changes by more than theta.
+//
+// Note - the solution assumes cards are dealt from an infinite deck.
+//        Blackjack is episodic, so values are undiscounted.
+//
+// Output:
+//    - The number of sweeps performed.
+//
+int valueIterationSolver(Agent* agent, double theta) {
+    // Exact values, indexed like the dense value table.
+    double q[NUM_STATE_ACTIONS] = {};
+    State state;
+    Action action;
+    int sweeps = 0;
+    double delta;
+    do {
+        delta = 0;
+        for (int idx=0; idx<NUM_STATE_ACTIONS; idx++) {
+            DenseValueTable::decode(idx, state, action);
+            double value = actionValue(q, state, action);
+            delta = max(delta, fabs(value - q[idx]));
+            q[idx] = value;
+        }
+        sweeps++;
+        TRACE(TRACE_EPISODES, traceSweep(sweeps, delta));
+    } while (delta > theta);
+    // Store the solution in the agent's estimates.
+    for (int idx=0; idx<NUM_STATE_ACTIONS; idx++) {
+        DenseValueTable::decode(idx, state, action);
+        agent->getStateActionValue(&state, action)->setValue(q[idx]);
+    }
+    return sweeps;
+}
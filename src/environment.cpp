@@ -3,23 +3,80 @@
 #include <cstdlib>
 #include <iostream>
 #include <iterator>
-#include <random>
+#include <memory>
 #include <string>
-#include <vector>
 
+#include "dealer.hpp"
 #include "seed.hpp"
 #include "environment.hpp"
-#include "verbose.hpp"
+#include "shoe.hpp"
+#include "start.hpp"
+#include "trace.hpp"
 
-// Deals a card from the deck with replacement
-// And returns the value associated with the card.
+// Shoe configuration shared by every thread.
+// Zero decks means cards are dealt from an infinite deck.
+static int shoe_decks = 0;
+static double shoe_penetration = 1;
+// Each thread deals from its own shoe, created on first use.
+static thread_local unique_ptr<Shoe> shoe;
+
+// How the dealer's hand is played out, shared by every thread.
+static DealerMode dealer_mode = SequentialDealer;
+// Each thread draws batched dealer outcomes from its own buffers.
+static thread_local DealerOutcomes dealer_outcomes;
+
+// How starting states are chosen, shared by every thread.
+static StartMode start_mode = DealtStart;
+// Each thread makes its own passes over the starting states.
+static thread_local StartStrata start_strata;
+
+// Configures how the environment plays out the dealer's hand.
+//
+// Must be called before any episodes are generated.
+//
+void useDealer(DealerMode mode) {
+    dealer_mode = mode;
+}
+
+// Configures how the environment chooses the episodes' starting states.
+//
+// Must be called before any episodes are generated.
+//
+void useStarts(StartMode mode) {
+    start_mode = mode;
+}
+
+// Configures the environment to deal from a finite shoe of ndecks decks,
+// reshuffled once the given penetration has been dealt.
+// Passing zero decks restores the infinite deck.
+//
+// Must be called before any episodes are generated.
+//
+void useShoe(int ndecks, double penetration) {
+    shoe_decks = ndecks;
+    shoe_penetration = penetration;
+    shoe.reset();
+}
+
+// Gets the calling thread's shoe, creating it on first use.
+//
+static Shoe* threadShoe() {
+    if (!shoe)
+        shoe = make_unique<Shoe>(shoe_decks, shoe_penetration);
+    return shoe.get();
+}
+
+// Deals a card and returns the value associated with the card.
+//
+// Cards are dealt from the shoe if one is configured. Otherwise,
+// they are dealt from an infinite deck, i.e. with replacement.
 //
 int dealCard() {
-    vector<int> deck{2, 3, 4, 5, 6, 7, 8, 9,
-                    10, 10, 10, 10, 11};
-    uniform_int_distribution<> deck_idx_dist(0, deck.size()-1);
-    int card = deck[deck_idx_dist(generator)];
-    return card;
+    if (shoe_decks > 0)
+        return threadShoe()->deal();
+    static const int deck[13] = {2, 3, 4, 5, 6, 7, 8, 9,
+                                 10, 10, 10, 10, 11};
+    return deck[generator.bounded(13)];
 }
 
 // Checks if the current state is busted.
@@ -47,57 +104,95 @@ bool checkTerminal(State* state) {
     return state->count() >= 21;
 }
 
+// Deals the starting state from the shoe.
+//
+// Cards dealt from a shoe depend on the cards already dealt, so the
+// hand is redealt if it is a blackjack.
+//
+static void dealStartingState(State* state) {
+    do {
+        int card1 = dealCard();
+        int card2 = dealCard();
+        int up_card = dealCard();
+        TRACE(TRACE_CARDS, traceCard(card1, false));
+        TRACE(TRACE_CARDS, traceCard(card2, false));
+        TRACE(TRACE_CARDS, traceCard(up_card, true));
+        *state = State(card1+card2, up_card, (card1 == 11) + (card2 == 11),
+                       card1 == card2 ? Pair : Opening);
+        checkTerminal(state);
+    } while (state->count() == 21);
+}
+
 // Initialize the given state to a starting blackjack state.
 // This means dealing two cards to the player (agent) and
-// one face up card to the dealer.
+// one face up card to the dealer, or choosing such a state
+// directly, depending on the start mode.
 // Aces dealt are also accounted for in the state.
 //
+// The state is never terminal, see StartMode.
+//
+// If cards are dealt from a shoe which has passed the cut card,
+// then it is reshuffled before the new hand.
+//
 void setStartingState(State* state) {
-    /*
-    // Declare distributions.
-    uniform_int_distribution<> ace_dist(1, 169);
-    uniform_int_distribution<> hard_cnt_dist(4, 20);
-    uniform_int_distribution<> soft_cnt_dist(12, 20);
-    uniform_int_distribution<> dealer_dist(2, 11);
-    // Set hard or soft state.
-    // Note: this is scaled according to the probability
-    // of being dealt atleast one ace, 48/169.
-    state->setUsableAces(ace_dist(generator) <= 48);
-    // Set player count depending on hard or soft state.
-    if (state->usableAces())
-        state->setCount(soft_cnt_dist(generator));
-    else
-        state->setCount(hard_cnt_dist(generator));
-    // Set dealer count
-    state->setDealer(dealer_dist(generator));
-    */
-    /*
-    // Deal the first card to the player.
-    int card1 = dealCard();
-    state->setCount(card1);
-    if (card1 == 11)
-        state->incUsableAces();
-    // Deal the second card to the player.
-    int card2 = dealCard();
-    state->setCount(state->count()+card2);
-    if (card2 == 11)
-        state->incUsableAces();
-    checkTerminal(state);
-    // Deal the card to the dealer.
-    state->setDealer(dealCard());
-    */
-    state->setCount(17);
-    state->setUsableAces(0);
-    state->setDealer(8);
+    if (shoe_decks > 0)
+        threadShoe()->newHand();
+    switch (start_mode) {
+        case FixedStart:
+            *state = State(17, 8, 0, Opening);
+            break;
+        case DealtStart:
+            if (shoe_decks > 0)
+                dealStartingState(state);
+            else
+                *state = start_distribution.sample();
+            break;
+        case ExploringStart:
+            *state = start_distribution.state(generator.bounded(NUM_START_STATES));
+            break;
+        case StratifiedStart:
+            *state = start_strata.next();
+            break;
+        // Handle error
+        default:
+            cerr << "Unrecognized start mode!" << endl;
+            abort();
+    }
 }
 
 // Returns the set of valid actions for a given state
 //
+// Note - the valid actions are always the first state->numActions()
+//        actions, which is what the value tables and the agent use.
+//
 set<Action> validActions(const State* state) {
-    // Note: for now there are only two actions which are always valid,
-    // hit and stay. This function is included to enable support for
-    // double and split actions in the future. 
-    return {Hit, Stay};
+    set<Action> actions;
+    for (int a=0; a<state->numActions(); a++)
+        actions.insert((Action) a);
+    return actions;
+}
+
+// Gets the value of each card of a pair.
+//
+int pairCard(const State* state) {
+    return state->hard() ? state->count()/2 : 11;
+}
+
+// Deals one of the two hands made by splitting a pair.
+// The hand holds one card of the pair and a newly dealt card.
+//
+// Input:
+//    - pair: a state in the Pair phase.
+// Output:
+//    - _hand is overwritten with the hand's starting state.
+//    - Whether the hand is terminal, i.e. it was dealt 21.
+//
+bool dealSplitHand(const State* pair, State& _hand) {
+    int first = pairCard(pair);
+    int card = dealCard();
+    TRACE(TRACE_CARDS, traceCard(card, false));
+    _hand = State(first+card, pair->dealer(), (first == 11) + (card == 11), SplitHand);
+    return checkTerminal(&_hand);
 }
 
 // Return the winner
@@ -157,18 +252,25 @@ Reward determineWinner(int player, int dealer) {
 // - Outcome of the blackjack hand (win, lose, or draw)
 //
 Reward endGame(int player_count, int dealer_count) {
+    // Draw the dealer's final count from a simulated batch
+    // or the exact distribution if possible.
+    if (dealer_mode != SequentialDealer && shoe_decks == 0) {
+        int final_count = (dealer_mode == BatchedDealer) ?
+            dealer_outcomes.next(dealer_count) :
+            dealer_distribution.sample(dealer_count);
+        Reward reward = determineWinner(player_count, final_count);
+        TRACE(TRACE_CARDS, traceDealerFinal(player_count, final_count, reward));
+        return reward;
+    }
     // Initialize the dealer's state using the face up card.
     State state(dealer_count, 0, dealer_count==11);
     State* p_state = &state;
     // The dealer must hit while its count is less than 17.
     int card;
     while (p_state->count() < 17) {
-        // Log state.
-        if (VERBOSE) cout << "Dealer state: " << *p_state << endl;
         // Draw a card.
         card = dealCard();
-        // Log dealt card.
-        if (VERBOSE) cout << "Card dealt: " << card << endl;
+        TRACE(TRACE_CARDS, traceCard(card, true));
         // Update count.
         p_state->setCount(p_state->count()+card);
         // Update usable ace count.
@@ -177,10 +279,22 @@ Reward endGame(int player_count, int dealer_count) {
         // Account for usable aces.
         checkTerminal(p_state);
     }
-    // Log final player and dealer count.
-    if (VERBOSE) cout << "Player: " << player_count << "  Dealer: " << p_state->count() << endl;
     // Return the reward based on who won the game.
-    return determineWinner(player_count, p_state->count());
+    Reward reward = determineWinner(player_count, p_state->count());
+    TRACE(TRACE_CARDS, traceDealerFinal(player_count, p_state->count(), reward));
+    return reward;
+}
+
+// This function determines the player's reward at the end of the episode.
+//
+// In the expected dealer mode, the reward is the player's exact expected
+// reward given the final player count and the dealer's up card.
+// Otherwise, the dealer's hand is played out with endGame.
+//
+double finalReward(int player_count, int dealer_count) {
+    if (dealer_mode == ExpectedDealer && shoe_decks == 0)
+        return dealer_distribution.expectedReward(player_count, dealer_count);
+    return endGame(player_count, dealer_count);
 }
 
 // This function conveys the dynamics of the environment by applying the
@@ -192,54 +306,64 @@ Reward endGame(int player_count, int dealer_count) {
 //    - Action for timestep t
 // Output:
 //    - Reward recieved after taking action in state.
-//    - _state points to the resultant next state
+//    - _state is overwritten with the resultant next state
+//    - _terminal is set if the hand has ended, in which case
+//      _state is left unspecified.
+//
+// Note - splitting ends the pair's hand with no reward. The two split
+//        hands are dealt with dealSplitHand and played out by the caller,
+//        see generateEpisode.
 //
-Reward transform(const State* state, const Action& action, State** _state) {
-    // Initialize the pointer to the next state.
-    State* p_next_state = NULL;
-    Reward reward;
+double transform(const State* state, const Action& action, State& _state, bool& _terminal) {
     // Apply the given action to the state
     switch(action) {
         case Hit:
             {
-                // Log action.
-                if (VERBOSE) cout << "Action: Hit" << endl;
-                // Initialize the next state object as a shallow copy of
-                // the current state.
-                p_next_state = new State(state);
+                // Initialize the next state as a copy of the current state.
+                _state = *state;
                 // Add a card from the deck to the player's count.
                 int card = dealCard();
-                p_next_state->setCount(p_next_state->count()+card);
-                // Log the dealt card.
-                if (VERBOSE) cout << "Dealt card: " << card << endl;
+                _state.setCount(_state.count()+card);
+                TRACE(TRACE_CARDS, traceCard(card, false));
                 // Update next state if an ace was dealt.
                 if (card == 11)
-                    p_next_state->incUsableAces();
-                // If we aren't in a terminal state, then set the output state ptr
-                // to the next state and return no reward.
-                if (!checkTerminal(p_next_state)) {
-                    *_state = p_next_state;
+                    _state.incUsableAces();
+                // Only hitting and staying are valid after a hit.
+                _state.setPhase(Drawn);
+                // If we aren't in a terminal state, then return no reward.
+                _terminal = checkTerminal(&_state);
+                if (!_terminal)
                     return None;
-                }
-                // Log busted
-                if (VERBOSE) cout << "Terminal state." << endl;
                 // Else, we busted and must determine if we lost or got a draw.
-                reward = endGame(p_next_state->count(), p_next_state->dealer());
-                delete(p_next_state);
-                *_state = NULL;
-                return reward;
+                return finalReward(_state.count(), _state.dealer());
             }   
         case Stay:
-            // Log action.
-            if (VERBOSE) cout << "Action: Stay" << endl;
-            // Determine an outcome.
-            reward = endGame(state->count(), state->dealer());
-            // Terminal state, next state is NULL.
-            *_state = NULL;
-            return reward;
+            // Terminal state, determine an outcome.
+            _terminal = true;
+            return finalReward(state->count(), state->dealer());
+        case Double:
+            {
+                // Take exactly one more card for twice the stake.
+                _state = *state;
+                int card = dealCard();
+                _state.setCount(_state.count()+card);
+                TRACE(TRACE_CARDS, traceCard(card, false));
+                if (card == 11)
+                    _state.incUsableAces();
+                checkTerminal(&_state);
+                _terminal = true;
+                return 2*finalReward(_state.count(), _state.dealer());
+            }
+        case Surrender:
+            // Give up half of the stake.
+            _terminal = true;
+            return -0.5;
+        case Split:
+            _terminal = true;
+            return None;
         // Handle unrecognized actions
         default:
             cout << "Unrecognized action!" << endl;
             abort();
     }
-}
\ No newline at end of file
+}
@@ -1,39 +1,83 @@
+#include <cstdlib>
 #include <iostream>
 
 #include "agent.hpp"
 #include "environment.hpp"
 #include "episode.hpp"
-#include "verbose.hpp"
+#include "trace.hpp"
 
-// This function generates a episode using the given agent.
-Episode* generateEpisode(Agent& agent) {
-    // Log function call.
-    if (VERBOSE) cout << "Generating a new episode." << endl;
-    // Declare episode variables.
-    Episode* episode = new Episode;
-    Timestep t;
-    State* state = new State; 
-    State* next_state = NULL;
+// Appends a timestep to the episode.
+//
+void Episode::push(const Timestep& t) {
+    // Handle error
+    if (m_size == MAX_EPISODE_LENGTH) {
+        cerr << "Episode exceeded the maximum length." << endl;
+        abort();
+    }
+    m_timesteps[m_size++] = t;
+}
+
+// Plays out a hand from the given non-terminal state, appending its
+// timesteps to the episode as a new hand.
+//
+// If the agent splits, the split hands are played out after the pair's
+// hand, and their total reward becomes the split's reward.
+//
+// Output:
+//    - The hand's total reward.
+//
+template <class PolicyT>
+static double playHand(Agent& agent, PolicyT& policy, State state, Episode& episode) {
+    // Declare hand variables.
+    State next_state;
     Action action;
-    Reward reward;
-    // Initialize state to a valid starting state.
-    // Note: excluding dealt blackjacks as starting states.
-    do {
-        setStartingState(state);
-    } while (state->count() == 21);
+    double reward;
+    double probability;
+    double total = 0;
+    bool terminal = false;
     // While the state is non-terminal.
-    while(state != NULL) {
-        // Log state.
-        if (VERBOSE) cout << "State: " << *state << endl;
+    while(!terminal) {
         // Make an action
-        reward = agent.act(state, action, &next_state);
-        // Log the reward.
-        if (VERBOSE) cout << "Reward: " << reward << endl;
-        // Add the (state, action, reward) tuple to the episode.
-        t = make_tuple(state, action, reward);
-        episode->push(t);
+        reward = agent.act(policy, &state, action, probability, next_state, terminal);
+        TRACE(TRACE_EPISODES, traceStep(state, action, reward));
+        // Add the (state, action, reward, probability) tuple to the episode.
+        episode.push(make_tuple(state, action, reward, probability));
+        total += reward;
         // Advance to the next state.
         state = next_state;
     }
-    return episode;
-}
\ No newline at end of file
+    episode.endHand();
+    if (action != Split)
+        return total;
+    // Play out both split hands. The split is always the pair's first
+    // and only action, so the hands' rewards are its total reward.
+    int split = episode.size()-1;
+    total = playSplitHands(get<0>(episode[split]), [&](const State& hand) {
+        return playHand(agent, policy, hand, episode);
+    });
+    get<2>(episode[split]) = total;
+    return total;
+}
+
+// This function generates a episode using the given agent.
+//
+// Note - each split hand plays out its own dealer hand against the
+//        shared face up card. Every hand's expected reward is the same as
+//        against a single dealer hand, only the hands are uncorrelated.
+//
+template <class PolicyT>
+void generateEpisode(Agent& agent, PolicyT& policy, Episode& episode) {
+    TRACE(TRACE_EPISODES, traceEpisode());
+    State state;
+    episode.clear();
+    // Initialize state to a valid starting state.
+    // Note: dealt blackjacks are never starting states.
+    setStartingState(&state);
+    playHand(agent, policy, state, episode);
+}
+
+
+// Explicit instantiations for each policy type.
+#define INSTANTIATE_GENERATE_EPISODE(PolicyT) \
+    template void generateEpisode<PolicyT>(Agent&, PolicyT&, Episode&);
+FOR_EACH_POLICY(INSTANTIATE_GENERATE_EPISODE)
@@ -1,17 +1,23 @@
+#include <algorithm>
 #include <cstdlib>
-#include <stack>
 #include <tuple>
-#include <unordered_set>
-#include <map>
 
 #include "environment.hpp"
 #include "episode.hpp"
 #include "montecarlo.hpp"
 #include "policy.hpp"
-#include "verbose.hpp"
+#include "progress.hpp"
+#include "replay.hpp"
 
 using namespace std;
 
+// Importance sampling used by the off-policy learners.
+static ImportanceSampling sampling = WeightedSampling;
+
+void useImportanceSampling(ImportanceSampling mode) {
+    sampling = mode;
+}
+
 // This function performs on-policy monte carlo 
 // policy evaluation and improvement.
 //
@@ -32,62 +38,75 @@ using namespace std;
 // Output:
 //    - The given function's state-action values have been improved.
 //
-void onPolicyLearner(Agent* agent, unsigned long long niters, double gamma) {
+template <class PolicyT>
+void onPolicyLearner(Agent* agent, unsigned long long niters, double gamma,
+                     TrainingObserver* observer) {
+    // Resolve the agent's policy type once, outside of the loop.
+    PolicyT& policy = policyAs<PolicyT>(*agent);
+    // Policy evaluation and iteration loop.
+    // The episode buffer is reused across iterations.
+    Episode episode;
+    runRounds(agent, niters, observer, [&](unsigned long long n) {
+        for (unsigned long long i=0; i<n; i++) {
+            // Generate an episode
+            generateEpisode(*agent, policy, episode);
+            // Update the agent's value estimates with the episode's returns.
+            onPolicyUpdate(agent, episode, gamma);
+        }
+    });
+}
+
+// This function updates the agent's value estimates using the
+// first-visit returns of the given hand.
+//
+// Input:
+//    - steps: the hand's n timesteps, in order.
+//
+void onPolicyUpdate(Agent* agent, const Timestep* steps, int n, double gamma) {
     // Declare variables
     double rtrn;
-    Timestep t;
-    State* state;
+    const State* state;
     Action action;
-    Reward reward;
-    // Policy evaluation and iteration loop.
-    Episode* episode;
-    for (unsigned long long int i=0; i<niters; i++) {
-        // Log percentage completion in 10% increments
-        if (!VERBOSE && i % (niters/10) == 0) {
-            cout << "--> " << 100*((double)i/(double)niters) << "%" << endl;
-            agent->printPolicyMatrix();
-            //agent->policy().printStats();
-            cout << endl;
-            for (int dealer=2; dealer <= 11; dealer++) {
-                State test_state(17, dealer, 0);
-                cout << test_state << endl;
-                cout << "Hit:  " << *(agent->getStateActionValue(&test_state, Hit)) << endl;
-                cout << "Stay: " << *(agent->getStateActionValue(&test_state, Stay)) << endl;
-                cout << endl;
-            }
-        }
-        // Log start of loop
-        if (VERBOSE) cout << "-----------------------------------" << endl;
-        // Generate an episode
-        episode = generateEpisode(*agent);
-        // Iteratate through the episode timesteps.
-        unordered_set<pair<State, Action>, SAHashFunction> seen_before;
-        rtrn = 0;
-        while(!episode->empty()) {
-            // Unpack timestep
-            t = episode->top();
-            state  = get<0>(t);
-            action = get<1>(t);
-            reward = get<2>(t);
-            // Update average return if this is the first visit to 
-            // the state-action pair.
-            if (seen_before.find({*state, action}) == seen_before.end()) {
-                rtrn = gamma*rtrn + reward;
-                agent->updateStateActionValue(state, action, rtrn);
-                seen_before.insert({*state, action});
-            } else if(VERBOSE) {
-                // Log seen before state
-                cout << "State seen before: " << state << endl;
-            }
-            // Deallocate the state memory
-            delete(state);
-            // Remove the timestep from the episode.
-            episode->pop();
+    double reward;
+    // Iteratate through the episode timesteps, last to first.
+    // Pairs already visited are kept in a fixed-size array since
+    // episodes are short.
+    pair<State, Action> seen_before[MAX_EPISODE_LENGTH];
+    int nseen = 0;
+    rtrn = 0;
+    for (int i=n-1; i>=0; i--) {
+        // Unpack timestep
+        state  = &get<0>(steps[i]);
+        action = get<1>(steps[i]);
+        reward = get<2>(steps[i]);
+        // Update average return if this is the first visit to 
+        // the state-action pair.
+        pair<State, Action> sa_pair(*state, action);
+        if (find(seen_before, seen_before+nseen, sa_pair) == seen_before+nseen) {
+            rtrn = gamma*rtrn + reward;
+            agent->updateStateActionValue(state, action, rtrn);
+            seen_before[nseen++] = sa_pair;
         }
-        delete(episode);
     }
 }
 
+// Applies the update for every hand of the episode.
+// The episode's timesteps are consumed.
+//
+void onPolicyUpdate(Agent* agent, Episode& episode, double gamma) {
+    for (int h=0; h<episode.hands(); h++)
+        onPolicyUpdate(agent, &episode[episode.handStart(h)], episode.handLength(h), gamma);
+    episode.clear();
+}
+
+// Applies the on-policy update for every hand in the buffer,
+// oldest first.
+//
+void onPolicyUpdate(Agent* agent, const ReplayBuffer& buffer, double gamma) {
+    for (int i=0; i<buffer.hands(); i++)
+        onPolicyUpdate(agent, buffer.steps(i), buffer.length(i), gamma);
+}
+
 // This function performs off-policy monte carlo 
 // policy evaluation and improvement.
 //
@@ -111,75 +130,216 @@ void onPolicyLearner(Agent* agent, unsigned long long niters, double gamma) {
 // Output:
 //    - The given function's state-action values have been improved.
 //
-void offPolicyLearner(Agent* agent, unsigned long long niters, double gamma) {
+template <class PolicyT>
+void offPolicyLearner(Agent* agent, unsigned long long niters, double gamma,
+                      TrainingObserver* observer) {
+    // Resolve the agent's policy type once, outside of the loop.
+    PolicyT& policy = policyAs<PolicyT>(*agent);
+    // Policy evaluation and iteration loop.
+    // The episode buffer is reused across iterations.
+    Episode episode;
+    runRounds(agent, niters, observer, [&](unsigned long long n) {
+        for (unsigned long long i=0; i<n; i++) {
+            // Generate an episode
+            generateEpisode(*agent, policy, episode);
+            // Update the agent's value estimates with the episode's returns.
+            offPolicyUpdate(agent, episode, gamma);
+        }
+    });
+}
+
+// This function updates the agent's value estimates using importance
+// sampling on the every-visit returns of the given hand.
+//
+// The target policy is greedy, so the importance sampling ratio of an
+// action is 1/b(a|s) if it's greedy, where b is the behavior policy,
+// and 0 otherwise. The return of each step is weighted by the product
+// of the ratios of the steps after it:
+//    - Ordinary sampling averages the weighted returns, counting each
+//      return once, including those with zero weight.
+//    - Weighted sampling averages the returns with their weights.
+//      Returns with zero weight have no effect, so the hand is only
+//      walked back to its last non-greedy action.
+//    - Per-decision sampling weights each reward of the return by the
+//      ratios of the steps between it and the step, and averages the
+//      returns like ordinary sampling.
+//
+// The averages are kept by the agent's estimates, so the weight of an
+// estimate is the total weight of its returns, over all episodes
+// experienced so far.
+//
+// Input:
+//    - steps: the hand's n timesteps, in order.
+//    - split_reward: the reward of the hand's split, if it ends with
+//      one, in place of the recorded reward, see offPolicyEpisodeUpdate.
+//
+// Output:
+//    - The hand's sampled return. With ordinary and weighted sampling
+//      it's the hand's return weighted by the ratios of all of its
+//      steps, and with per-decision sampling each reward is weighted by
+//      the ratios of the steps up to it.
+//
+static double offPolicyHandUpdate(Agent* agent, const Timestep* steps, int n, double gamma,
+                                  double split_reward) {
     // Declare variables
     double rtrn;
-    Timestep t;
-    State* state;
+    const State* state;
     Action action;
-    Reward reward;
+    double reward;
     double weight;
-    // Total weight from the first n returns of the episode,
-    // accumulated over all episodes experienced.
-    map<pair<State, Action>, int> cum_weight;
-    // Policy evaluation and iteration loop.
-    Episode* episode;
-    for (unsigned long long int i=0; i<niters; i++) {
-        // Log percentage completion in 10% increments
-        if (!VERBOSE && i % (niters/10) == 0) {
-            cout << "--> " << 100*((double)i/(double)niters) << "%" << endl;
-            agent->printPolicyMatrix();
-        }
-        // Log start of loop
-        if (VERBOSE) cout << "-----------------------------------" << endl;
-        // Generate an episode
-        episode = generateEpisode(*agent);
-        // Log.
-        if (VERBOSE) { 
-            cout << endl;
-            cout << "Updating value estimates." << endl;
+    double ratio;
+    // Iteratate through the episode timesteps, last to first.
+    // With per-decision sampling the ratios are folded into the return,
+    // and the weight stays 1.
+    rtrn = 0; weight = 1;
+    for (int i=n-1; i>=0; i--) {
+        // Unpack timestep
+        state = &get<0>(steps[i]);
+        action = get<1>(steps[i]);
+        reward = (action == Split) ? split_reward : get<2>(steps[i]);
+        // Update return
+        rtrn = gamma*rtrn + reward;
+        // Add the return to the average for the state-action pair.
+        if (sampling == WeightedSampling)
+            agent->weightedUpdateStateActionValue(state, action, rtrn, weight);
+        else
+            agent->updateStateActionValue(state, action, weight*rtrn);
+        // Get the ratio of the action, with the behavior probability
+        // recorded when the action was taken.
+        if (action == agent->getGreedyAction(state))
+            ratio = 1/get<3>(steps[i]);
+        else
+            ratio = 0;
+        if (sampling == PerDecisionSampling)
+            rtrn *= ratio;
+        else
+            weight *= ratio;
+        // Exit this episode once the remaining returns have no weight.
+        if (sampling == WeightedSampling && weight == 0)
+            return 0;
+    }
+    return weight*rtrn;
+}
+
+// Gets the total reward of a hand, as recorded for a split.
+//
+static double handReward(const Timestep* steps, int n) {
+    double total = 0;
+    for (int i=0; i<n; i++)
+        total += get<2>(steps[i]);
+    return total;
+}
+
+// Applies the off-policy update to the hands of an episode, the dealt
+// hand followed by its split hands, given as their timesteps.
+//
+// The recorded reward of a split is the total reward of the split hands
+// as the behavior policy played them, so the split hands are updated
+// first, and the reward of each one in the split's reward is replaced
+// with its sampled return. A hand dealt 21 takes no actions, so its
+// reward is kept as is.
+//
+static void offPolicyEpisodeUpdate(Agent* agent, const Timestep* const hands[], 
+                                   const int lengths[], int nhands, double gamma) {
+    const Timestep& last = hands[0][lengths[0]-1];
+    double split_reward = get<2>(last);
+    for (int h=1; h<nhands; h++)
+        split_reward += offPolicyHandUpdate(agent, hands[h], lengths[h], gamma, 0) -
+                        handReward(hands[h], lengths[h]);
+    offPolicyHandUpdate(agent, hands[0], lengths[0], gamma, split_reward);
+}
+
+// Applies the update for every hand of the episode.
+// The episode's timesteps are consumed.
+//
+void offPolicyUpdate(Agent* agent, Episode& episode, double gamma) {
+    const Timestep* hands[MAX_HANDS];
+    int lengths[MAX_HANDS];
+    for (int h=0; h<episode.hands(); h++) {
+        hands[h] = &episode[episode.handStart(h)];
+        lengths[h] = episode.handLength(h);
+    }
+    offPolicyEpisodeUpdate(agent, hands, lengths, episode.hands(), gamma);
+    episode.clear();
+}
+
+// Applies the off-policy update for every episode in the buffer,
+// oldest first.
+//
+// The buffer doesn't record where its episodes start, but only split
+// hands start in the SplitHand phase, so an episode is a hand followed
+// by every hand which does.
+//
+void offPolicyUpdate(Agent* agent, const ReplayBuffer& buffer, double gamma) {
+    const Timestep* hands[MAX_HANDS];
+    int lengths[MAX_HANDS];
+    int i = 0;
+    while (i < buffer.hands()) {
+        int nhands = 0;
+        do {
+            hands[nhands] = buffer.steps(i);
+            lengths[nhands++] = buffer.length(i++);
+        } while (i < buffer.hands() && get<0>(*buffer.steps(i)).phase() == SplitHand);
+        offPolicyEpisodeUpdate(agent, hands, lengths, nhands, gamma);
+    }
+}
+
+// This function performs on-policy monte carlo policy evaluation and 
+// improvement, alternating between generating a batch of episodes into 
+// a replay buffer and applying the updates for the whole batch.
+//
+// Input:
+//    - batch: the number of episodes generated before updating.
+//
+template <class PolicyT>
+void onPolicyBatchLearner(Agent* agent, unsigned long long niters, int batch,
+                          double gamma, TrainingObserver* observer) {
+    PolicyT& policy = policyAs<PolicyT>(*agent);
+    ReplayBuffer buffer(batch);
+    runRounds(agent, niters, observer, [&](unsigned long long n) {
+        unsigned long long i = 0;
+        while (i < n) {
+            // Generation stage.
+            i += generateEpisodes(*agent, policy, buffer, n - i);
+            // Update stage.
+            onPolicyUpdate(agent, buffer, gamma);
+            buffer.clear();
         }
-        // Iteratate through the episode timesteps.
-        rtrn = 0; weight = 1;
-        while(!episode->empty()) {
-            // Unpack timestep
-            t = episode->top();
-            state = get<0>(t);
-            action = get<1>(t);
-            reward = get<2>(t);
-            // Update return
-            rtrn = gamma*rtrn + reward;
-            // Log.
-            if (VERBOSE) {
-                cout << "State: " << *state << "  Action: " << action << "  Reward: " << reward << endl;
-                cout << "Return: " << rtrn << endl; 
-            }
-            // Update cummulative reward for the state-action pair.
-            if (cum_weight.find({*state, action}) == cum_weight.end())
-                cum_weight[{*state, action}] = weight;
-            else
-                cum_weight[{*state, action}] += weight;
-            // Perform a weighted update on the agent's state-action value.
-            agent->weightedUpdateStateActionValue(state, 
-                                                  action, 
-                                                  rtrn, 
-                                                  weight/cum_weight[{*state, action}]);
-            // Exit this episode if the action taken by the behavior policy
-            // doesn't match the greedy (target) policy.
-            if (action != agent->getGreedyAction(state)) {
-                if(VERBOSE)
-                    cout << "Exiting early: " << action << " != " << agent->getGreedyAction(state) << endl;
-                delete(state);
-                break;
-            }
-            // Update weight according to the probability of the behavior policy
-            // taking the action in the given state.
-            weight /= agent->actionProbability(action, state);
-            // Deallocate the state memory
-            delete(state);
-            // Remove the timestep from the episode.
-            episode->pop();
+    });
+}
+
+// This function performs off-policy monte carlo policy evaluation and 
+// improvement, alternating between generating a batch of episodes into 
+// a replay buffer and applying the updates for the whole batch.
+//
+// Input:
+//    - batch: the number of episodes generated before updating.
+//
+template <class PolicyT>
+void offPolicyBatchLearner(Agent* agent, unsigned long long niters, int batch,
+                           double gamma, TrainingObserver* observer) {
+    PolicyT& policy = policyAs<PolicyT>(*agent);
+    ReplayBuffer buffer(batch);
+    runRounds(agent, niters, observer, [&](unsigned long long n) {
+        unsigned long long i = 0;
+        while (i < n) {
+            // Generation stage.
+            i += generateEpisodes(*agent, policy, buffer, n - i);
+            // Update stage.
+            offPolicyUpdate(agent, buffer, gamma);
+            buffer.clear();
         }
-        delete(episode);
-    }
-}
\ No newline at end of file
+    });
+}
+
+// Explicit instantiations for each policy type.
+#define INSTANTIATE_LEARNERS(PolicyT) \
+    template void onPolicyLearner<PolicyT>(Agent*, unsigned long long, double, \
+                                           TrainingObserver*); \
+    template void offPolicyLearner<PolicyT>(Agent*, unsigned long long, double, \
+                                            TrainingObserver*); \
+    template void onPolicyBatchLearner<PolicyT>(Agent*, unsigned long long, int, double, \
+                                                TrainingObserver*); \
+    template void offPolicyBatchLearner<PolicyT>(Agent*, unsigned long long, int, double, \
+                                                 TrainingObserver*);
+FOR_EACH_POLICY(INSTANTIATE_LEARNERS)
@@ -0,0 +1,260 @@
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "montecarlo.hpp"
+#include "parallel.hpp"
+#include "progress.hpp"
+#include "seed.hpp"
+#include "valuetable.hpp"
+
+using namespace std;
+
+// Private training state owned by a single worker thread.
+struct Worker {
+    Policy* policy;
+    Agent* agent;
+    unsigned long long niters;
+};
+
+// Creates a worker for each thread and splits the iterations between them.
+//
+// Each worker gets a copy of the agent's current estimates and policy,
+// or shares the agent's estimates if share_values is set.
+// The split only depends on the number of threads so that a given seed
+// and thread count always produce the same result.
+//
+static vector<Worker*> createWorkers(Agent* agent, unsigned long long niters, unsigned nthreads,
+                                     bool share_values=false) {
+    vector<Worker*> workers;
+    for (unsigned k=0; k<nthreads; k++) {
+        Worker* worker = new Worker;
+        worker->policy = agent->policy().clone();
+        if (share_values)
+            worker->agent = new Agent(agent->values(), *worker->policy);
+        else
+            worker->agent = new Agent(agent->values().clone(), *worker->policy);
+        worker->niters = niters/nthreads + (k < niters%nthreads);
+        workers.push_back(worker);
+    }
+    return workers;
+}
+
+// Runs the given training function on every worker in its own thread
+// and waits for all of them to finish.
+//
+// Worker k reseeds its thread's generator from k and a draw from the
+// calling thread's generator, so that repeated runs (e.g. after resuming
+// from a checkpoint) don't replay the same streams.
+//
+template <typename Function>
+static void runWorkers(vector<Worker*>& workers, Function train) {
+    vector<thread> threads;
+    uint64_t base = generator();
+    for (unsigned k=0; k<workers.size(); k++) {
+        threads.emplace_back([&workers, &train, base, k]() {
+            generator.seed(base, k);
+            train(workers[k]);
+        });
+    }
+    for (thread& t : threads)
+        t.join();
+}
+
+// Adds the returns each worker added to its copy of the estimates to
+// the agent's estimates. Every estimate is a weighted average, so the
+// merged value is the average over every worker's returns.
+//
+static void mergeWorkerValues(Agent* agent, vector<Worker*>& workers) {
+    State state;
+    Action action;
+    for (int idx=0; idx<NUM_STATE_ACTIONS; idx++) {
+        DenseValueTable::decode(idx, state, action);
+        AvgReturn* value = agent->getStateActionValue(&state, action);
+        double base_total = value->totalReturns();
+        double base_weight = value->weight();
+        for (Worker* worker : workers) {
+            AvgReturn* worker_value = worker->agent->getStateActionValue(&state, action);
+            value->merge(worker_value->totalReturns() - base_total,
+                         worker_value->weight() - base_weight);
+        }
+    }
+}
+
+// Adds the policy counts made by the workers to the agent's policy.
+//
+static void mergeWorkerCounters(Agent* agent, vector<Worker*>& workers) {
+    vector<Policy*> policies;
+    for (Worker* worker : workers)
+        policies.push_back(worker->policy);
+    mergeCounters(agent->policy(), policies);
+}
+
+// Deallocates the workers.
+//
+static void deleteWorkers(vector<Worker*>& workers) {
+    for (Worker* worker : workers) {
+        delete(worker->agent);
+        delete(worker->policy);
+        delete(worker);
+    }
+}
+
+// This function performs on-policy monte carlo policy evaluation 
+// and improvement across nthreads worker threads.
+//
+// Each worker averages the returns from its own episodes. The returns
+// each worker added to its copy of an estimate are then added to the
+// agent's estimate, so the merged value is the average over every
+// worker's episodes.
+//
+template <class PolicyT>
+static void parallelOnPolicyRound(Agent* agent, unsigned long long niters, 
+                                  unsigned nthreads, double gamma) {
+    vector<Worker*> workers = createWorkers(agent, niters, nthreads);
+    // Generate episodes in parallel.
+    runWorkers(workers, [gamma](Worker* worker) {
+        PolicyT& policy = policyAs<PolicyT>(*worker->agent);
+        Episode episode;
+        for (unsigned long long i=0; i<worker->niters; i++) {
+            generateEpisode(*worker->agent, policy, episode);
+            onPolicyUpdate(worker->agent, episode, gamma);
+        }
+    });
+    mergeWorkerValues(agent, workers);
+    mergeWorkerCounters(agent, workers);
+    deleteWorkers(workers);
+}
+
+// This function performs off-policy monte carlo policy evaluation 
+// and improvement across nthreads worker threads.
+//
+// Each worker's estimate is a weighted average of its returns, and is
+// merged like the on-policy estimates.
+//
+template <class PolicyT>
+static void parallelOffPolicyRound(Agent* agent, unsigned long long niters, 
+                                   unsigned nthreads, double gamma) {
+    vector<Worker*> workers = createWorkers(agent, niters, nthreads);
+    // Generate episodes in parallel.
+    runWorkers(workers, [gamma](Worker* worker) {
+        PolicyT& policy = policyAs<PolicyT>(*worker->agent);
+        Episode episode;
+        for (unsigned long long i=0; i<worker->niters; i++) {
+            generateEpisode(*worker->agent, policy, episode);
+            offPolicyUpdate(worker->agent, episode, gamma);
+        }
+    });
+    mergeWorkerValues(agent, workers);
+    mergeWorkerCounters(agent, workers);
+    deleteWorkers(workers);
+}
+
+// This function performs on-policy monte carlo policy evaluation 
+// and improvement with nthreads workers updating the agent's estimates
+// directly, Hogwild style.
+//
+// The agent's value table must be concurrent, and there is nothing to
+// merge once the workers finish.
+//
+template <class PolicyT>
+static void hogwildOnPolicyRound(Agent* agent, unsigned long long niters, 
+                                 unsigned nthreads, double gamma) {
+    vector<Worker*> workers = createWorkers(agent, niters, nthreads, true);
+    runWorkers(workers, [gamma](Worker* worker) {
+        PolicyT& policy = policyAs<PolicyT>(*worker->agent);
+        Episode episode;
+        for (unsigned long long i=0; i<worker->niters; i++) {
+            generateEpisode(*worker->agent, policy, episode);
+            onPolicyUpdate(worker->agent, episode, gamma);
+        }
+    });
+    mergeWorkerCounters(agent, workers);
+    deleteWorkers(workers);
+}
+
+// This function performs off-policy monte carlo policy evaluation 
+// and improvement with nthreads workers updating the agent's estimates
+// directly, Hogwild style.
+//
+// The cumulative weights are the shared estimates' weights, so like the
+// on-policy round there is nothing to merge once the workers finish.
+//
+template <class PolicyT>
+static void hogwildOffPolicyRound(Agent* agent, unsigned long long niters, 
+                                  unsigned nthreads, double gamma) {
+    vector<Worker*> workers = createWorkers(agent, niters, nthreads, true);
+    runWorkers(workers, [gamma](Worker* worker) {
+        PolicyT& policy = policyAs<PolicyT>(*worker->agent);
+        Episode episode;
+        for (unsigned long long i=0; i<worker->niters; i++) {
+            generateEpisode(*worker->agent, policy, episode);
+            offPolicyUpdate(worker->agent, episode, gamma);
+        }
+    });
+    mergeWorkerCounters(agent, workers);
+    deleteWorkers(workers);
+}
+
+// Checks that the agent's estimates can be updated by many threads.
+//
+static void requireConcurrent(Agent* agent) {
+    // Handle error
+    if (!agent->values().concurrent()) {
+        cerr << "Hogwild training requires a concurrent value table!" << endl;
+        abort();
+    }
+}
+
+template <class PolicyT>
+void parallelOnPolicyLearner(Agent* agent, unsigned long long niters, 
+                             unsigned nthreads, double gamma,
+                             TrainingObserver* observer) {
+    runRounds(agent, niters, observer, [=](unsigned long long n) {
+        parallelOnPolicyRound<PolicyT>(agent, n, nthreads, gamma);
+    });
+}
+
+template <class PolicyT>
+void parallelOffPolicyLearner(Agent* agent, unsigned long long niters, 
+                              unsigned nthreads, double gamma,
+                              TrainingObserver* observer) {
+    runRounds(agent, niters, observer, [=](unsigned long long n) {
+        parallelOffPolicyRound<PolicyT>(agent, n, nthreads, gamma);
+    });
+}
+
+template <class PolicyT>
+void hogwildOnPolicyLearner(Agent* agent, unsigned long long niters, 
+                            unsigned nthreads, double gamma,
+                            TrainingObserver* observer) {
+    requireConcurrent(agent);
+    runRounds(agent, niters, observer, [=](unsigned long long n) {
+        hogwildOnPolicyRound<PolicyT>(agent, n, nthreads, gamma);
+    });
+}
+
+template <class PolicyT>
+void hogwildOffPolicyLearner(Agent* agent, unsigned long long niters, 
+                             unsigned nthreads, double gamma,
+                             TrainingObserver* observer) {
+    requireConcurrent(agent);
+    runRounds(agent, niters, observer, [=](unsigned long long n) {
+        hogwildOffPolicyRound<PolicyT>(agent, n, nthreads, gamma);
+    });
+}
+
+// Explicit instantiations for each policy type.
+#define INSTANTIATE_PARALLEL_LEARNERS(PolicyT) \
+    template void parallelOnPolicyLearner<PolicyT>(Agent*, unsigned long long, unsigned, double, \
+                                                   TrainingObserver*); \
+    template void parallelOffPolicyLearner<PolicyT>(Agent*, unsigned long long, unsigned, double, \
+                                                    TrainingObserver*); \
+    template void hogwildOnPolicyLearner<PolicyT>(Agent*, unsigned long long, unsigned, double, \
+                                                  TrainingObserver*); \
+    template void hogwildOffPolicyLearner<PolicyT>(Agent*, unsigned long long, unsigned, double, \
+                                                   TrainingObserver*);
+FOR_EACH_POLICY(INSTANTIATE_PARALLEL_LEARNERS)
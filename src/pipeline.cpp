@@ -0,0 +1,199 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "montecarlo.hpp"
+#include "pipeline.hpp"
+#include "replay.hpp"
+#include "seed.hpp"
+#include "spsc.hpp"
+
+using namespace std;
+
+// Number of batches each generator can have in flight.
+const int PIPELINE_BUFFERS = 4;
+
+// State shared between a generator thread and the updater.
+//
+// Batches circulate between the two queues, so the buffers are only ever
+// allocated once. Snapshots are handed over through their own queue and
+// are owned by the generator from then on.
+//
+struct Generator {
+    Policy* policy;
+    // The generator's current snapshot of the agent's estimates.
+    ValueTable* snapshot;
+    unsigned long long niters;
+    ReplayBuffer* buffers[PIPELINE_BUFFERS];
+    // Filled batches, generator -> updater.
+    SpscQueue<ReplayBuffer*, PIPELINE_BUFFERS> full;
+    // Applied batches, updater -> generator.
+    SpscQueue<ReplayBuffer*, PIPELINE_BUFFERS> empty;
+    // New snapshots, updater -> generator.
+    SpscQueue<ValueTable*, 2> snapshots;
+    // Set by the updater when the run stops early.
+    atomic<bool> stop{false};
+};
+
+// Generator thread loop.
+//
+// Before each batch the generator switches to the newest snapshot it
+// has been sent, then fills an empty buffer with episodes.
+//
+template <class PolicyT>
+static void generate(Generator* gen) {
+    PolicyT& policy = policyAs<PolicyT>(*gen->policy);
+    unsigned long long remaining = gen->niters;
+    while (remaining > 0 && !gen->stop.load(memory_order_relaxed)) {
+        // Switch to the newest snapshot.
+        ValueTable* table;
+        while (gen->snapshots.pop(table)) {
+            delete(gen->snapshot);
+            gen->snapshot = table;
+        }
+        // Wait for the updater to return a buffer.
+        ReplayBuffer* buffer;
+        while (!gen->empty.pop(buffer)) {
+            if (gen->stop.load(memory_order_relaxed)) return;
+            this_thread::yield();
+        }
+        Agent view(*gen->snapshot, *gen->policy);
+        remaining -= generateEpisodes(view, policy, *buffer, remaining);
+        // There are as many slots as buffers, so this never waits.
+        while (!gen->full.push(buffer))
+            this_thread::yield();
+    }
+}
+
+// Runs the generator threads and applies their batches to the agent
+// with the given update function on the calling thread.
+//
+// Generator k reseeds its thread's generator from k and a draw from the
+// calling thread's generator, like the parallel workers.
+//
+template <class PolicyT, typename Update>
+static void runPipeline(Agent* agent, unsigned long long niters, unsigned nthreads,
+                        int batch, unsigned long long publish_every,
+                        TrainingObserver* observer, Update update) {
+    // Handle error
+    // Without generators the updater would wait for batches forever.
+    if (nthreads < 1) {
+        cerr << "The pipeline needs at least one generator thread!" << endl;
+        abort();
+    }
+    // Create the generators and split the episodes between them.
+    vector<Generator*> generators;
+    for (unsigned k=0; k<nthreads; k++) {
+        Generator* gen = new Generator;
+        gen->policy = agent->policy().clone();
+        gen->snapshot = agent->values().clone();
+        gen->niters = niters/nthreads + (k < niters%nthreads);
+        for (int b=0; b<PIPELINE_BUFFERS; b++) {
+            gen->buffers[b] = new ReplayBuffer(batch);
+            gen->empty.push(gen->buffers[b]);
+        }
+        generators.push_back(gen);
+    }
+    // Start the generators.
+    vector<thread> threads;
+    uint64_t base = generator();
+    for (unsigned k=0; k<nthreads; k++) {
+        threads.emplace_back([&generators, base, k]() {
+            generator.seed(base, k);
+            generate<PolicyT>(generators[k]);
+        });
+    }
+    // Apply batches as they arrive.
+    auto start = chrono::steady_clock::now();
+    unsigned long long done = 0;
+    unsigned long long since_publish = 0;
+    unsigned long long next_report = 0;
+    while (done < niters) {
+        // Report progress between batches.
+        if (observer != nullptr && done >= next_report) {
+            double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            observer->onProgress(*agent, {done, niters, elapsed});
+            if (observer->shouldStop()) break;
+            next_report = nextReport(observer, done, niters);
+        }
+        bool idle = true;
+        for (Generator* gen : generators) {
+            ReplayBuffer* buffer;
+            if (!gen->full.pop(buffer)) continue;
+            idle = false;
+            update(*buffer);
+            done += buffer->size();
+            since_publish += buffer->size();
+            buffer->clear();
+            gen->empty.push(buffer);
+        }
+        // Publish a new snapshot to every generator.
+        // A generator which hasn't picked up its last two snapshots
+        // skips this one.
+        if (since_publish >= publish_every) {
+            for (Generator* gen : generators) {
+                ValueTable* table = agent->values().clone();
+                if (!gen->snapshots.push(table))
+                    delete(table);
+            }
+            since_publish = 0;
+        }
+        if (idle) this_thread::yield();
+    }
+    // Batches still queued when the run stops early are dropped.
+    for (Generator* gen : generators)
+        gen->stop.store(true, memory_order_relaxed);
+    for (thread& t : threads)
+        t.join();
+    // Add the generators' policy counts to the agent's policy.
+    vector<Policy*> policies;
+    for (Generator* gen : generators)
+        policies.push_back(gen->policy);
+    mergeCounters(agent->policy(), policies);
+    // Deallocate the generators.
+    for (Generator* gen : generators) {
+        ValueTable* table;
+        while (gen->snapshots.pop(table))
+            delete(table);
+        delete(gen->snapshot);
+        for (int b=0; b<PIPELINE_BUFFERS; b++)
+            delete(gen->buffers[b]);
+        delete(gen->policy);
+        delete(gen);
+    }
+}
+
+template <class PolicyT>
+void pipelinedOnPolicyLearner(Agent* agent, unsigned long long niters,
+                              unsigned nthreads, int batch, double gamma,
+                              unsigned long long publish_every,
+                              TrainingObserver* observer) {
+    runPipeline<PolicyT>(agent, niters, nthreads, batch, publish_every, observer,
+                         [agent, gamma](const ReplayBuffer& buffer) {
+        onPolicyUpdate(agent, buffer, gamma);
+    });
+}
+
+template <class PolicyT>
+void pipelinedOffPolicyLearner(Agent* agent, unsigned long long niters,
+                               unsigned nthreads, int batch, double gamma,
+                               unsigned long long publish_every,
+                               TrainingObserver* observer) {
+    runPipeline<PolicyT>(agent, niters, nthreads, batch, publish_every, observer,
+                         [agent, gamma](const ReplayBuffer& buffer) {
+        offPolicyUpdate(agent, buffer, gamma);
+    });
+}
+
+// Explicit instantiations for each policy type.
+#define INSTANTIATE_PIPELINED_LEARNERS(PolicyT) \
+    template void pipelinedOnPolicyLearner<PolicyT>(Agent*, unsigned long long, unsigned, int, \
+                                                    double, unsigned long long, \
+                                                    TrainingObserver*); \
+    template void pipelinedOffPolicyLearner<PolicyT>(Agent*, unsigned long long, unsigned, int, \
+                                                     double, unsigned long long, \
+                                                     TrainingObserver*);
+FOR_EACH_POLICY(INSTANTIATE_PIPELINED_LEARNERS)
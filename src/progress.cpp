@@ -0,0 +1,46 @@
+#include <iostream>
+
+#include "progress.hpp"
+
+// Prints the percentage completed, the training rate and the
+// agent's policy matrix.
+//
+void PolicyMatrixPrinter::onProgress(const Agent& agent, const Progress& progress) {
+    cout << "--> " << 100*((double)progress.iteration/(double)progress.niters) << "%";
+    if (progress.elapsed > 0)
+        cout << "  (" << (unsigned long long) (progress.iteration/progress.elapsed) << " iterations/s)";
+    cout << endl;
+    agent.printPolicyMatrix();
+}
+
+// Gets the shortest interval of the observers.
+//
+unsigned long long ObserverGroup::minInterval(const vector<TrainingObserver*>& observers) {
+    unsigned long long interval = 0;
+    for (TrainingObserver* observer : observers)
+        if (interval == 0 || observer->interval() < interval)
+            interval = observer->interval();
+    return interval;
+}
+
+// Calls every observer whose next report is due.
+//
+// A report at an iteration before the previous one is the start of a
+// new run, e.g. the next chunk of a checkpointed run.
+//
+void ObserverGroup::onProgress(const Agent& agent, const Progress& progress) {
+    bool restart = progress.iteration == 0 || progress.iteration < m_last;
+    for (TrainingObserver* observer : m_observers) {
+        unsigned long long interval = observer->interval();
+        if (restart || progress.iteration/interval > m_last/interval)
+            observer->onProgress(agent, progress);
+    }
+    m_last = progress.iteration;
+}
+
+bool ObserverGroup::shouldStop() const {
+    for (TrainingObserver* observer : m_observers)
+        if (observer->shouldStop())
+            return true;
+    return false;
+}
@@ -0,0 +1,60 @@
+#include <cstdlib>
+#include <iostream>
+
+#include "replay.hpp"
+
+// Allocates the buffer's storage up front.
+//
+ReplayBuffer::ReplayBuffer(int max_episodes, int max_steps) :
+    m_max_episodes(max_episodes),
+    m_nsteps(0),
+    m_nhands(0),
+    m_nepisodes(0) {
+    // Handle error
+    if (max_episodes < 1) {
+        cerr << "Replay buffer must hold at least one episode." << endl;
+        abort();
+    }
+    if (max_steps < MAX_EPISODE_LENGTH)
+        max_steps = 4*max_episodes + MAX_EPISODE_LENGTH;
+    m_steps.resize(max_steps);
+    m_ends.resize(max_episodes*MAX_HANDS);
+}
+
+// Appends a copy of the episode's timesteps.
+//
+void ReplayBuffer::add(Episode& episode) {
+    // Handle error
+    if (m_nepisodes == m_max_episodes ||
+        m_nsteps + episode.size() > (int) m_steps.size()) {
+        cerr << "Replay buffer is full." << endl;
+        abort();
+    }
+    int start = m_nsteps;
+    for (int t=0; t<episode.size(); t++)
+        m_steps[m_nsteps++] = episode[t];
+    for (int h=0; h<episode.hands(); h++)
+        m_ends[m_nhands++] = start + episode.handStart(h) + episode.handLength(h);
+    m_nepisodes++;
+}
+
+// Generates episodes with the agent until n have been generated
+// or the buffer is full.
+//
+template <class PolicyT>
+unsigned long long generateEpisodes(Agent& agent, PolicyT& policy,
+                                    ReplayBuffer& buffer, unsigned long long n) {
+    Episode episode;
+    unsigned long long i = 0;
+    for (; i<n && !buffer.full(); i++) {
+        generateEpisode(agent, policy, episode);
+        buffer.add(episode);
+    }
+    return i;
+}
+
+// Explicit instantiations for each policy type.
+#define INSTANTIATE_GENERATE_EPISODES(PolicyT) \
+    template unsigned long long generateEpisodes<PolicyT>(Agent&, PolicyT&, \
+                                                          ReplayBuffer&, unsigned long long);
+FOR_EACH_POLICY(INSTANTIATE_GENERATE_EPISODES)
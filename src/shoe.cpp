@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "seed.hpp"
+#include "shoe.hpp"
+
+// Fills the shoe with ndecks decks and shuffles it.
+//
+// Input:
+//    - ndecks: number of decks in [1, 8]
+//    - penetration: fraction of the shoe dealt before reshuffling, in (0, 1]
+//
+Shoe::Shoe(int ndecks, double penetration) {
+    // Handle error
+    if (ndecks < MIN_DECKS || ndecks > MAX_DECKS || 
+        penetration <= 0 || penetration > 1) {
+        cerr << "Invalid shoe: " << ndecks << " decks, " 
+             << penetration << " penetration." << endl;
+        abort();
+    }
+    // Each deck has four of each card value, 2-9 and ace,
+    // and sixteen ten-valued cards.
+    m_size = 0;
+    for (int deck=0; deck<ndecks; deck++) {
+        for (int suit=0; suit<4; suit++) {
+            for (int card=2; card<=11; card++)
+                m_cards[m_size++] = card;
+            for (int face=0; face<3; face++)
+                m_cards[m_size++] = 10;
+        }
+    }
+    m_cut = (int) (penetration*m_size);
+    shuffle();
+}
+
+// Fisher-Yates shuffle of the full shoe.
+//
+void Shoe::shuffle() {
+    std::shuffle(m_cards, m_cards+m_size, generator);
+    m_cursor = 0;
+}
@@ -0,0 +1,67 @@
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+#include "environment.hpp"
+#include "start.hpp"
+
+const StartDistribution start_distribution;
+
+// Enumerates every deal of ranks from an infinite deck, and the distinct
+// starting states they lead to.
+//
+// Hands with the same count, softness and phase are the same state, so a
+// state's probability is the fraction of the deals which lead to it.
+//
+StartDistribution::StartDistribution() {
+    // Values of the 13 ranks.
+    static const int deck[13] = {2, 3, 4, 5, 6, 7, 8, 9,
+                                 10, 10, 10, 10, 11};
+    // Position of each state in the list, by state index.
+    int slot[NUM_STATES];
+    for (int i=0; i<NUM_STATES; i++) slot[i] = -1;
+    int n = 0;
+    int ndeals = 0;
+    for (int up=0; up<13; up++) {
+        for (int rank1=0; rank1<13; rank1++) {
+            for (int rank2=0; rank2<13; rank2++) {
+                int card1 = deck[rank1], card2 = deck[rank2];
+                State state(card1+card2, deck[up], (card1 == 11) + (card2 == 11),
+                            card1 == card2 ? Pair : Opening);
+                checkTerminal(&state);
+                // Skip blackjacks
+                if (state.count() == 21) continue;
+                int& i = slot[state.index()];
+                // Handle error
+                if (ndeals == NUM_DEALS || (i < 0 && n == NUM_START_STATES)) {
+                    cerr << "Too many starting states." << endl;
+                    abort();
+                }
+                if (i < 0) {
+                    i = n++;
+                    m_states[i] = state;
+                    m_probs[i] = 0;
+                }
+                m_probs[i] += 1.0/NUM_DEALS;
+                m_deals[ndeals++] = state;
+            }
+        }
+    }
+    // Handle error
+    if (n != NUM_START_STATES || ndeals != NUM_DEALS) {
+        cerr << "Missing starting states." << endl;
+        abort();
+    }
+}
+
+// Gets the next starting state, reshuffling the order with a
+// Fisher-Yates shuffle at the start of each pass.
+//
+const State& StartStrata::next() {
+    if (m_cursor == NUM_START_STATES) {
+        for (int i=NUM_START_STATES-1; i>0; i--)
+            swap(m_order[i], m_order[generator.bounded(i+1)]);
+        m_cursor = 0;
+    }
+    return start_distribution.state(m_order[m_cursor++]);
+}
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+#include "environment.hpp"
+#include "episode.hpp"
+#include "policy.hpp"
+#include "td.hpp"
+#include "trace.hpp"
+
+using namespace std;
+
+// Eligibility traces of the state-action pairs visited in a hand.
+// Hands are short, so the pairs are kept in a fixed-size array.
+//
+struct Traces {
+    pair<State, Action> pairs[MAX_EPISODE_LENGTH];
+    double traces[MAX_EPISODE_LENGTH];
+    int size = 0;
+    // Sets the trace of the given pair to one, and returns its index.
+    int visit(const State& state, Action action) {
+        pair<State, Action> sa_pair(state, action);
+        int k = find(pairs, pairs+size, sa_pair) - pairs;
+        if (k == size) pairs[size++] = sa_pair;
+        traces[k] = 1;
+        return k;
+    }
+    // Scales every trace by the given factor.
+    void decay(double factor) {
+        if (factor == 0) size = 0;
+        for (int k=0; k<size; k++)
+            traces[k] *= factor;
+    }
+};
+
+// Moves the estimate of every traced pair by alpha*delta, scaled by
+// its trace. Only the step's own pair, at index current, counts the
+// step in its weight.
+//
+static void applyError(Agent& agent, const Traces& traces, int current,
+                       double alpha, double delta) {
+    for (int k=0; k<traces.size; k++) {
+        const State* state = &traces.pairs[k].first;
+        Action action = traces.pairs[k].second;
+        double q = agent.getStateActionValue(state, action)->value();
+        agent.stepStateActionValue(state, action, q + delta, alpha*traces.traces[k],
+                                   k == current);
+    }
+}
+
+// Gets the value of the next state that the method bootstraps from.
+//
+// Input:
+//    - values: the estimates of the next state's actions.
+//    - next_action: the action the policy takes in the next state.
+//
+template <class PolicyT>
+static double nextValue(PolicyT& policy, TDMethod method, const ActionValues& values,
+                        Action next_action) {
+    switch (method) {
+        // The valid actions are a prefix of Action, so the view is
+        // indexed by action.
+        case Sarsa:
+            return values.value(next_action)->value();
+        case ExpectedSarsa: {
+            double expected = 0;
+            for (int i=0; i<values.size(); i++)
+                expected += selectionProbability(policy, values.action(i), values) *
+                            values.value(i)->value();
+            return expected;
+        }
+        case QLearning:
+            return values.value(greedyAction(values))->value();
+    }
+    // Handle error
+    cerr << "Unknown TD method!" << endl;
+    abort();
+}
+
+// Plays out a hand from the given non-terminal state, updating the
+// agent's estimates after every step.
+//
+// If the agent splits, the split hands are played out, and the split's
+// reward is what they're worth to the method, see td.hpp.
+//
+// Output:
+//    - The hand's total reward.
+//
+template <class PolicyT>
+static double playHand(Agent& agent, PolicyT& policy, TDMethod method, double alpha,
+                       double lambda, double gamma, State state) {
+    // Declare hand variables.
+    Traces traces;
+    State next_state;
+    Action action = agent.getAction(policy, &state);
+    Action next_action = action;
+    double reward;
+    double total = 0;
+    bool terminal = false;
+    // While the state is non-terminal.
+    while (!terminal) {
+        // Take the action chosen in the last step.
+        reward = transform(&state, action, next_state, terminal);
+        TRACE(TRACE_EPISODES, traceStep(state, action, reward));
+        // Play out both split hands, see playHand in episode.cpp.
+        // Sarsa's target is the hands' total reward. The other methods
+        // bootstrap from each hand's starting state, before it's played.
+        if (action == Split) {
+            reward += playSplitHands(state, [&](const State& hand) {
+                double value = 0;
+                if (method != Sarsa) {
+                    ActionValues values = agent.getActionValues(&hand);
+                    value = nextValue(policy, method, values, greedyAction(values));
+                }
+                double total = playHand(agent, policy, method, alpha, lambda, gamma, hand);
+                return method == Sarsa ? total : value;
+            });
+        }
+        total += reward;
+        // Choose the next action, and bootstrap from the next state.
+        double target = reward;
+        bool greedy = true;
+        if (!terminal) {
+            ActionValues values = agent.getActionValues(&next_state);
+            next_action = selectAction(policy, values);
+            target += gamma*nextValue(policy, method, values, next_action);
+            greedy = (method != QLearning ||
+                      values.value(next_action)->value() ==
+                      values.value(greedyAction(values))->value());
+        }
+        // Update the estimates with the step's error.
+        double delta = target - agent.getStateActionValue(&state, action)->value();
+        int current = traces.visit(state, action);
+        applyError(agent, traces, current, alpha, delta);
+        traces.decay(greedy ? gamma*lambda : 0);
+        // Advance to the next state.
+        state = next_state;
+        action = next_action;
+    }
+    return total;
+}
+
+// This function performs online temporal difference control.
+//
+// Input:
+//    - agent: the agent to be trained
+//
+//      Note - the function assumes the agent's policy has coverage
+//             of the action space.
+//
+//    - niters: the number of episodes to learn from before returning.
+//
+//    - method: the target of each update, see TDMethod.
+//
+//    - alpha: the step size.
+//
+//    - lambda: the trace decay, 0 for one-step updates.
+//
+//    - gamma: the discount rate.
+//
+//      Note - this should always be 1 because blackjack is an episodic game.
+//             It's included as a parameter for the sake of generality.
+//
+// Output:
+//    - The given function's state-action values have been improved.
+//
+template <class PolicyT>
+void tdLearner(Agent* agent, unsigned long long niters, TDMethod method,
+               double alpha, double lambda, double gamma,
+               TrainingObserver* observer) {
+    // Resolve the agent's policy type once, outside of the loop.
+    PolicyT& policy = policyAs<PolicyT>(*agent);
+    runRounds(agent, niters, observer, [&](unsigned long long n) {
+        for (unsigned long long i=0; i<n; i++) {
+            // Play an episode, learning as it goes.
+            TRACE(TRACE_EPISODES, traceEpisode());
+            State state;
+            setStartingState(&state);
+            playHand(*agent, policy, method, alpha, lambda, gamma, state);
+        }
+    });
+}
+
+// Explicit instantiations for each policy type.
+#define INSTANTIATE_TD_LEARNER(PolicyT) \
+    template void tdLearner<PolicyT>(Agent*, unsigned long long, TDMethod, \
+                                     double, double, double, TrainingObserver*);
+FOR_EACH_POLICY(INSTANTIATE_TD_LEARNER)
@@ -0,0 +1,276 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "trace.hpp"
+
+// Number of records buffered per thread, a power of two.
+const size_t TRACE_RING_SIZE = 1 << 14;
+
+// Single producer, single consumer ring of trace records.
+//
+// The emitting thread advances head and the writer thread advances tail.
+// Both only ever increase, the slot is the index modulo the ring size.
+//
+struct TraceRing {
+    TraceRecord records[TRACE_RING_SIZE];
+    atomic<size_t> head{0};
+    atomic<size_t> tail{0};
+    // Set when the emitting thread exits, the writer then frees the
+    // ring once it has been drained.
+    atomic<bool> retired{false};
+};
+
+// Trace state shared by every thread.
+static atomic<bool> trace_enabled{false};
+static FILE* trace_file = nullptr;
+static mutex trace_mutex;
+static vector<TraceRing*> trace_rings;
+static uint16_t trace_threads = 0;
+static thread trace_writer;
+static atomic<bool> trace_running{false};
+
+// Per-thread tracing state.
+// The ring is registered with the writer the first time a thread traces.
+struct ThreadTrace {
+    TraceRing* ring = nullptr;
+    uint16_t thread = 0;
+    uint64_t episode = 0;
+    ~ThreadTrace() {
+        if (ring != nullptr) ring->retired.store(true, memory_order_release);
+    }
+};
+static thread_local ThreadTrace thread_trace;
+
+// Writes every buffered record of the ring to the trace file.
+// Returns the number of records written.
+//
+static size_t drain(TraceRing* ring) {
+    size_t tail = ring->tail.load(memory_order_relaxed);
+    size_t head = ring->head.load(memory_order_acquire);
+    size_t n = head - tail;
+    while (tail != head) {
+        // Write up to the end of the ring or the head, whichever is first.
+        size_t slot = tail % TRACE_RING_SIZE;
+        size_t count = min(head - tail, TRACE_RING_SIZE - slot);
+        fwrite(&ring->records[slot], sizeof(TraceRecord), count, trace_file);
+        tail += count;
+    }
+    ring->tail.store(tail, memory_order_release);
+    return n;
+}
+
+// Drains every ring and frees the rings of threads that have exited.
+//
+static size_t drainAll() {
+    lock_guard<mutex> lock(trace_mutex);
+    size_t n = 0;
+    for (size_t i=0; i<trace_rings.size(); ) {
+        TraceRing* ring = trace_rings[i];
+        bool retired = ring->retired.load(memory_order_acquire);
+        n += drain(ring);
+        if (retired) {
+            delete(ring);
+            trace_rings[i] = trace_rings.back();
+            trace_rings.pop_back();
+        } else {
+            i++;
+        }
+    }
+    return n;
+}
+
+// Background writer loop. Sleeps briefly whenever every ring is empty.
+//
+static void writeLoop() {
+    while (trace_running.load(memory_order_acquire)) {
+        if (drainAll() == 0)
+            this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+// Starts writing the trace records of every thread to the given path.
+//
+// Input:
+//    - path: the trace file, overwritten if it exists.
+// Output:
+//    - Whether the trace was opened.
+//
+bool traceOpen(const string& path) {
+    trace_file = fopen(path.c_str(), "wb");
+    if (trace_file == nullptr) {
+        cerr << "Could not open trace file: " << path << endl;
+        return false;
+    }
+    TraceHeader header = {};
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    fwrite(&header, sizeof(header), 1, trace_file);
+    trace_running.store(true, memory_order_release);
+    trace_writer = thread(writeLoop);
+    trace_enabled.store(true, memory_order_release);
+    return true;
+}
+
+// Stops the writer, writes the remaining records and closes the file.
+//
+void traceClose() {
+    if (trace_file == nullptr) return;
+    trace_enabled.store(false, memory_order_release);
+    trace_running.store(false, memory_order_release);
+    trace_writer.join();
+    drainAll();
+    fclose(trace_file);
+    trace_file = nullptr;
+}
+
+// Closes the trace if the program exits without closing it.
+static struct TraceGuard {
+    ~TraceGuard() { traceClose(); }
+} trace_guard;
+
+// Gets the calling thread's ring, registering it on first use.
+//
+static TraceRing* threadRing() {
+    if (thread_trace.ring == nullptr) {
+        TraceRing* ring = new TraceRing;
+        lock_guard<mutex> lock(trace_mutex);
+        thread_trace.thread = trace_threads++;
+        trace_rings.push_back(ring);
+        thread_trace.ring = ring;
+    }
+    return thread_trace.ring;
+}
+
+// Appends a record to the calling thread's ring.
+// If the ring is full, waits for the writer to catch up so that no
+// records are lost.
+//
+static void emit(TraceRecord record) {
+    if (!trace_enabled.load(memory_order_relaxed)) return;
+    TraceRing* ring = threadRing();
+    record.episode = thread_trace.episode;
+    record.thread = thread_trace.thread;
+    size_t head = ring->head.load(memory_order_relaxed);
+    while (head - ring->tail.load(memory_order_acquire) == TRACE_RING_SIZE)
+        this_thread::yield();
+    ring->records[head % TRACE_RING_SIZE] = record;
+    ring->head.store(head+1, memory_order_release);
+}
+
+// Fills in the state fields of a record.
+//
+static void setState(TraceRecord& record, const State& state) {
+    record.count = state.count();
+    record.dealer = state.dealer();
+    record.soft = !state.hard();
+}
+
+void traceEpisode() {
+    thread_trace.episode++;
+    TraceRecord record = {};
+    record.event = TraceEpisode;
+    emit(record);
+}
+
+void traceStep(const State& state, Action action, double reward) {
+    TraceRecord record = {};
+    record.event = TraceStep;
+    setState(record, state);
+    record.action = action;
+    record.reward = reward;
+    emit(record);
+}
+
+void traceUpdate(const State& state, Action action, double rtrn, double value) {
+    TraceRecord record = {};
+    record.event = TraceUpdate;
+    setState(record, state);
+    record.action = action;
+    record.reward = rtrn;
+    record.value = value;
+    emit(record);
+}
+
+void traceCard(int card, bool dealer) {
+    TraceRecord record = {};
+    record.event = dealer ? TraceDealerCard : TracePlayerCard;
+    record.card = card;
+    emit(record);
+}
+
+void traceDealerFinal(int player_count, int dealer_count, double reward) {
+    TraceRecord record = {};
+    record.event = TraceDealerFinal;
+    record.count = player_count;
+    record.dealer = dealer_count;
+    record.reward = reward;
+    emit(record);
+}
+
+// The sweep number is recorded in place of the episode number.
+//
+void traceSweep(int sweep, double delta) {
+    if (!trace_enabled.load(memory_order_relaxed)) return;
+    TraceRecord record = {};
+    record.event = TraceSweep;
+    record.reward = delta;
+    uint64_t episode = thread_trace.episode;
+    thread_trace.episode = sweep;
+    emit(record);
+    thread_trace.episode = episode;
+}
+
+// Prints the records of a trace file as text, one record per line.
+//
+// Input:
+//    - path: the trace file.
+//    - os: the output stream.
+// Output:
+//    - Whether the file was a valid trace.
+//
+bool dumpTrace(const string& path, ostream& os) {
+    ifstream file(path, ios::binary);
+    TraceHeader header;
+    if (!file.read((char*) &header, sizeof(header)) ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord)) {
+        cerr << "Not a trace file: " << path << endl;
+        return false;
+    }
+    const char* names[] = {"episode", "step", "update", "card", "dealer-card", "dealer-final", "sweep"};
+    TraceRecord record;
+    while (file.read((char*) &record, sizeof(record))) {
+        os << (int) record.thread << " " << record.episode << " " << names[record.event];
+        switch (record.event) {
+            case TraceStep:
+                os << " (" << (int) record.count << ", " << (int) record.dealer << ", "
+                   << (int) record.soft << ") " << (int) record.action << " " << record.reward;
+                break;
+            case TraceUpdate:
+                os << " (" << (int) record.count << ", " << (int) record.dealer << ", "
+                   << (int) record.soft << ") " << (int) record.action << " "
+                   << record.reward << " -> " << record.value;
+                break;
+            case TracePlayerCard:
+            case TraceDealerCard:
+                os << " " << (int) record.card;
+                break;
+            case TraceDealerFinal:
+                os << " " << (int) record.count << " vs " << (int) record.dealer << " " << record.reward;
+                break;
+            case TraceSweep:
+                os << " " << record.reward;
+                break;
+        }
+        os << endl;
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+#include <cstdlib>
+#include <iostream>
+
+#include "seed.hpp"
+#include "valuetable.hpp"
+
+// Value initialization shared by every table.
+static ValueInit value_init = HashedInit;
+static double init_value = 0;
+
+// Configures how new value estimates are initialized.
+//
+void useValueInit(ValueInit init, double value) {
+    value_init = init;
+    init_value = value;
+}
+
+// Gets the initial value estimate for the state-action pair.
+//
+// Hashed values only depend on the seed and the pair, not on the order
+// in which estimates are created, so they don't draw from the generator.
+//
+double initialValue(const State& state, const Action action) {
+    if (value_init == ConstantInit)
+        return init_value;
+    uint64_t bits = CounterRng::mix(seed ^ ((uint64_t) state.key() << 3 | action));
+    return 2*((bits >> 11) * 0x1.0p-53) - 1;
+}
+
+// Initializes every estimate in the table.
+//
+DenseValueTable::DenseValueTable() {
+    State state;
+    Action action;
+    for (int idx=0; idx<NUM_STATE_ACTIONS; idx++) {
+        decode(idx, state, action);
+        m_entries[idx] = AvgReturn(initialValue(state, action));
+    }
+}
+
+// States outside of the table bounds and invalid actions are
+// unrecognized and abort.
+//
+void DenseValueTable::invalidPair(const State& state, const Action action) {
+    if (!state.inBounds())
+        cerr << "State out of table bounds: " << state << endl;
+    else
+        cerr << "Action " << actionLetter(action) << " is not valid in state " << state << endl;
+    abort();
+}
+
+// Unpacks a dense table index back into its state-action pair.
+//
+void DenseValueTable::decode(int idx, State& state, Action& action) {
+    int offset = idx % BLOCK_SIZE;
+    int phase = NUM_PHASES-1;
+    while (phaseOffset(phase) > offset)
+        phase--;
+    action = (Action) (offset - phaseOffset(phase));
+    state = State::fromIndex((idx / BLOCK_SIZE)*NUM_PHASES + phase);
+}
+
+// Finds the estimate for the state-action pair with a single tree walk,
+// inserting a new estimate at the found position if it is missing.
+//
+AvgReturn* MapValueTable::get(const State& state, const Action action) {
+    pair<State, Action> key(state, action);
+    auto it = m_values->lower_bound(key);
+    if (it == m_values->end() || m_values->key_comp()(key, it->first))
+        it = m_values->emplace_hint(it, key, new AvgReturn(initialValue(state, action)));
+    return it->second;
+}
+
+// Copies every estimate into a new map.
+//
+ValueTable* MapValueTable::clone() const {
+    auto values = new map<pair<State, Action>, AvgReturn*>;
+    for (auto item : *m_values)
+        values->insert({item.first, new AvgReturn(*item.second)});
+    return new MapValueTable(values);
+}